@@ -13,6 +13,13 @@ local sun
 -- local movespeed = 5.0
 local time = 0.0
 
+local function push_position(positions, x, y, z)
+	local n = #positions
+	positions[n + 1] = x
+	positions[n + 2] = y
+	positions[n + 3] = z
+end
+
 function Init()
 	--- Load level assets ---
 	helmet_gltf = gltf.load("models/DamagedHelmet/DamagedHelmet.gltf")
@@ -36,24 +43,36 @@ function Init()
 	sun = lights.spawn_directional("Sun")
 	rotation.set_euler(sun, math.rad(-34), math.rad(-76), 0)
 
+	-- Tiles and soldiers are spawned in bulk from x, y, z lists
+	local ground_positions = {}
+	local ground_detail_positions = {}
 	for x = -5, 5 do
 		for z = -5, 5 do
 			local groundType = math.random(1, 3)
 			if groundType > 1 then
-				local ground = gltf.spawn(ground_gltf)
-				position.set(ground, x, 0, z)
+				push_position(ground_positions, x, 0, z)
 			else
-				local ground = gltf.spawn(ground_detail_gltf)
-				position.set(ground, x, 0, z)
+				push_position(ground_detail_positions, x, 0, z)
 			end
 		end
 	end
 
+	gltf.spawn_static(ground_gltf, ground_positions)
+	gltf.spawn_static(ground_detail_gltf, ground_detail_positions)
+
+	local soldier_positions = {}
 	for i = -5, 5 do
-		local soldier = gltf.spawn(soldier_gltf)
-		position.set(soldier, i, 0.0, 0.0)
+		push_position(soldier_positions, i, 0.0, 0.0)
 	end
 
+	gltf.spawn_many(soldier_gltf, soldier_positions)
+
+	-- Wall behind the soldiers, stamped into the pathing cost field
+	obstacles.spawn(0.0, -3.0, 7, 1)
+
+	-- Mud in front of them slows pathing through it
+	terrain.fill(-5.0, 2.0, 5.0, 4.0, terrain.type.mud)
+
 	my_helmet = gltf.spawn(helmet_gltf)
 	position.set(my_helmet, 1.0, 5.0, 8.0)
 end
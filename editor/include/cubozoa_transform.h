@@ -0,0 +1,105 @@
+#ifndef CBZ_TRANSFORM_H_
+#define CBZ_TRANSFORM_H_
+
+#include <cbz_ecs/cbz_ecs.h>
+#include <cbz_ecs/cbz_ecs_types.h>
+
+#include <glm/glm.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+namespace rts {
+struct JobSystem;
+}; // namespace rts
+
+// @brief Keeps the 'Transform' of entities with a Position, Rotation and Scale
+// up to date.
+// @note Nodes are stored grouped by depth so parents always come before their
+// children. Writers of Position, Rotation or Scale mark the entity dirty and
+// only dirty nodes and their descendants are recomputed, so settled nodes
+// cost nothing. The depth order is only rebuilt after structural changes,
+// which are seen through the query structure version.
+// Nodes of a depth level only depend on the level above, so large updates
+// split each level into chunks computed in parallel on 'jobs'.
+// Parents without a Position, Rotation and Scale are kept as matrix only nodes
+// whose world matrix is read from their 'Transform'.
+class TransformHierarchy {
+public:
+  TransformHierarchy(cbz::ecs::IWorld *world, rts::JobSystem *jobs);
+  ~TransformHierarchy();
+
+  // @brief Recomputes the world matrix of 'eId' and its descendants on the
+  // next update.
+  void markDirty(cbz::ecs::EntityId eId);
+
+  // @brief Rebuilds the depth order on the next update. Call after
+  // reparenting entities. Added components are picked up on their own.
+  void markStructureDirty();
+
+  // @brief Rebuilds the depth order if it was marked dirty or the world's
+  // structure changed. Queries the world, so call it where nothing else
+  // does, e.g. in a system's 'prepare'.
+  void refresh();
+
+  // @brief Writes the world matrices of dirty subtrees to their 'Transform'.
+  // @note Never queries the world. Call 'refresh' first.
+  void update();
+
+  inline uint32_t getNodeCount() const {
+    return static_cast<uint32_t>(mEntities.size());
+  }
+
+  // @brief Entities whose 'Transform' the last update wrote are
+  // [0, getUpdatedCount()).
+  inline uint32_t getUpdatedCount() const {
+    return static_cast<uint32_t>(mDirtyNodes.size());
+  }
+
+  inline cbz::ecs::EntityId getUpdatedEntity(uint32_t idx) const {
+    return mEntities[mDirtyNodes[idx]];
+  }
+
+private:
+  struct NodeComponents {
+    const Position *pos;
+    const Rotation *rot;
+    const Scale *scale;
+    Transform *transform;
+  };
+
+  void rebuild();
+
+  // @brief Computes the dirty nodes [begin, end) of 'mDirtyNodes'.
+  void computeNodes(uint32_t begin, uint32_t end);
+
+  static constexpr uint32_t kNoParent = UINT32_MAX;
+
+  cbz::ecs::IWorld *mWorld;
+  rts::JobSystem *mJobs;
+
+  // Nodes sorted by depth. Depth 'd' is [mLevelStarts[d], mLevelStarts[d + 1])
+  std::vector<cbz::ecs::EntityId> mEntities;
+  std::vector<uint32_t> mParents;
+  std::vector<uint32_t> mLevelStarts;
+  std::vector<glm::mat4> mWorldMatrices;
+  std::vector<uint8_t> mIsDirty;
+  std::vector<uint8_t> mIsMatrixOnly;
+  std::vector<uint32_t> mMatrixOnlyNodes;
+
+  std::unordered_map<cbz::ecs::EntityId, uint32_t> mNodeLookup;
+
+  // Lowest dirty node. Nodes before it are clean.
+  uint32_t mFirstDirtyNode;
+  bool mIsStructureDirty;
+
+  // Query structure version of the last rebuild
+  uint64_t mStructureVersion;
+
+  // Nodes being updated grouped by depth like 'mLevelStarts'
+  std::vector<uint32_t> mDirtyNodes;
+  std::vector<NodeComponents> mDirtyComponents;
+  std::vector<uint32_t> mDirtyLevelStarts;
+};
+
+#endif // CBZ_TRANSFORM_H_
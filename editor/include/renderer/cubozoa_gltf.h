@@ -4,6 +4,8 @@
 #include "renderer/cubozoa_render_types.h"
 #include <cbz_gfx/cbz_gfx.h>
 
+#include <vector>
+
 struct Camera;
 struct Primitive;
 class Transform;
@@ -16,9 +18,22 @@ public:
               const LightSource *lightSources, uint32_t count,
               Transform *transform, Primitive *mesh);
 
+  // @brief Adds 'material' to the material table shared by all primitives.
+  [[nodiscard]] MaterialHandle addMaterial(const Material &material);
+
+  // @returns a copy of the material of 'handle'.
+  [[nodiscard]] Material getMaterial(MaterialHandle handle) const;
+
+  // @brief Drops every material. Primitives still referencing them must not
+  // be rendered again.
+  void clearMaterials();
+
 private:
   cbz::ShaderHandle mGBufferShader;
   cbz::GraphicsProgramHandle mGBufferProgram;
+
+  // Indexed by 'Primitive::material'
+  std::vector<Material> mMaterials;
 };
 
 // TODO: move to asset/entity creation
@@ -26,16 +41,30 @@ private:
 #include <cbz_ecs/cbz_ecs_types.h>
 
 struct Gltf;
+
+// @param renderer owns the materials of the asset once loaded
 [[nodiscard]] extern std::unique_ptr<Asset<Gltf>>
-GltfAssetCreate(const std::string &path);
+GltfAssetCreate(const std::string &path, StaticMeshRenderer *renderer);
 
 [[nodiscard]] extern cbz::ecs::Entity
-EntityCreateFromGltf(cbz::ecs::IWorld *world, Asset<Gltf> *asset);
+EntityCreateFromGltf(cbz::ecs::IWorld *world, Asset<Gltf> *asset,
+                     bool isStatic = false);
+
+// @brief Spawns 'count' copies of the asset's hierarchy with their roots at
+// 'positions', or the origin if null.
+// @param isStatic bakes node transforms into the primitives, which are
+// parented straight to the root. For geometry whose nodes never move.
+// @note The hierarchy is flattened once when the asset loads so each copy is
+// one pass over a template instead of a walk over the glTF nodes.
+extern void EntitiesCreateFromGltf(cbz::ecs::IWorld *world, Asset<Gltf> *asset,
+                                   uint32_t count, const Position *positions,
+                                   cbz::ecs::Entity *outRoots,
+                                   bool isStatic = false);
 
-typedef uint32_t MaterialHandle;
 typedef uint32_t PrimitiveHandle;
 typedef uint32_t GltfHandle;
 
+#include <rts/rts.h>
 #include <sol/sol.hpp>
 
 struct TextureRef;
@@ -50,8 +79,23 @@ public:
   [[nodiscard]] TextureRef loadTexture(const std::string &path,
                                        CBZTextureFormat format);
 
+  // @brief Compiles the unit definitions in 'scriptDir' into the simulation
+  // unit table. Reuses the binary cache at 'cachePath' while the scripts are
+  // unchanged.
+  // @note Every '.lua' file in 'scriptDir' is run, so keep level scripts out
+  // of it.
+  [[nodiscard]] cbz::Result loadUnitTable(const std::string &scriptDir,
+                                          const std::string &cachePath);
+
+  // @returns the definition of archetype 'id' in the editor Lua state, e.g.
+  // to call its callbacks. Invalid if it has none.
+  [[nodiscard]] sol::table getUnitScript(UnitAssetId id) const;
+
 private:
   sol::state &mLua;
+
+  // Unit definitions by 'UnitAssetId', set by 'loadUnitTable'
+  std::vector<sol::table> mUnitScripts;
 };
 
 #endif // CBZ_GLTF_H_
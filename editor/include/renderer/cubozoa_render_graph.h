@@ -2,10 +2,14 @@
 #define CBZ_RENDER_GRAPH_H_
 
 #include "cubozoa_render_types.h"
+#include "cubozoa_transform.h"
 
 #include <cbz_ecs/cbz_ecs.h>
 #include <cbz_ecs/cbz_ecs_types.h>
 
+#include <rts/rts_arena.h>
+#include <rts/rts_scheduler.h>
+
 // --- Built-in Render Pipeline --
 typedef enum {
   RENDER_PASS_TYPE_SHADOW = 0,
@@ -99,14 +103,21 @@ private:
   cbz::ImageHandle mHighlightAttachment;
 };
 
+class StaticMeshRenderer;
 class DebugRenderPipeline {
 public:
-  DebugRenderPipeline(cbz::ecs::IWorld *world, uint32_t w, uint32_t h);
+  // @param staticMeshRenderer owns the materials shown in the inspector
+  DebugRenderPipeline(cbz::ecs::IWorld *world,
+                      TransformHierarchy *transformHierarchy,
+                      rts::SystemScheduler *scheduler,
+                      StaticMeshRenderer *staticMeshRenderer, uint32_t w,
+                      uint32_t h);
   ~DebugRenderPipeline();
 
   void focusEntity(cbz::ecs::Entity e);
 
-  void findPickables();
+  // @param frameArena backs the visible entity list for this frame
+  void findPickables(rts::FrameArena *frameArena);
   void renderPickable(const Camera &camera, const Transform &transform,
                       const Primitive &mesh);
 
@@ -134,6 +145,9 @@ protected:
   uint32_t sPickOriginY = 0;
 
   cbz::ecs::IWorld *mWorld;
+  TransformHierarchy *mTransformHierarchy;
+  rts::SystemScheduler *mScheduler;
+  StaticMeshRenderer *mStaticMeshRenderer;
 };
 
 #endif // CBZ_RENDER_GRAPH_H_
@@ -40,7 +40,8 @@ typedef enum : uint32_t {
   MATERIAL_PBR_TEXTURE_COUNT,
 } MaterialPBRTextures;
 
-// @brief A reference to a 'PrimitiveAsset'
+// @brief Textures, uniforms and program of a draw. Stored once in the
+// renderer's material table and referenced by 'MaterialHandle'.
 struct Material {
   TextureRef textures[MATERIAL_TEXTURE_MAX];
   uint8_t textureCount;
@@ -52,15 +53,15 @@ struct Material {
   MaterialPBRAsset *asset;
 };
 
-class PrimitiveAsset;
+// @brief Index into the renderer's material table
+typedef uint32_t MaterialHandle;
 
-// @brief A reference to a 'PrimitiveAsset'
+// @brief A mesh and the material it is drawn with
 struct Primitive {
   cbz::VertexBufferHandle vbh;
   cbz::IndexBufferHandle ibh;
 
-  Material materialRef;
-  PrimitiveAsset *asset;
+  MaterialHandle material;
 };
 
 typedef enum : uint32_t {
@@ -1,4 +1,5 @@
 #include "cbz_gfx/cbz_gfx_defines.h"
+#include "cubozoa_transform.h"
 #include "imgui.h"
 #include "renderer/cubozoa_gltf.h"
 #include "renderer/cubozoa_render_graph.h"
@@ -10,7 +11,10 @@
 #include <cbz_gfx/cbz_gfx_imgui.h>
 
 #include <cbz_ecs/cbz_ecs_types.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <thread>
 
 // TODO: Make into plug-in system
 #define SOL_ALL_SAFETIES_ON 1
@@ -35,6 +39,7 @@ static constexpr uint32_t mHeight = 1080;
 static float sTime;
 static float sLastTime;
 static float sDeltaTime;
+static std::chrono::steady_clock::time_point sStartTime;
 static uint32_t sFrameCtr;
 
 static Camera sCamera;
@@ -42,6 +47,7 @@ static Camera sCamera;
 // Level assets
 static std::vector<std::unique_ptr<Asset<Gltf>>> sGltfs;
 static std::unique_ptr<cbz::ecs::IWorld> sWorld;
+static std::unique_ptr<TransformHierarchy> sTransformHierarchy;
 static std::unique_ptr<AssetManager> sAssetManager;
 // static std::vector<std::unique_ptr<Asset<LuaScript>>> sScripts;
 
@@ -55,6 +61,14 @@ static std::unique_ptr<StaticMeshRenderer> sStaticMeshRenderer;
 
 // --- Game ---
 #include <rts/rts.h>
+#include <rts/rts_arena.h>
+#include <rts/rts_cost_field.h>
+#include <rts/rts_events.h>
+#include <rts/rts_job.h>
+#include <rts/rts_minimap.h>
+#include <rts/rts_scheduler.h>
+#include <rts/rts_selection.h>
+#include <rts/rts_status.h>
 
 static std::vector<float> sQuadVertices = {
     // x,   y,   z,    uv
@@ -80,6 +94,57 @@ cbz::GraphicsProgramHandle flowFieldProgram = {CBZ_INVALID_HANDLE};
 cbz::VertexBufferHandle QuadVBH = {CBZ_INVALID_HANDLE};
 cbz::IndexBufferHandle QuadIBH = {CBZ_INVALID_HANDLE};
 
+// Minimap
+static rts::Minimap sMinimap;
+cbz::ImageHandle minimapTexture = {CBZ_INVALID_HANDLE};
+
+// Worker threads shared by the editor and the simulation
+static rts::JobSystem sJobSystem;
+
+static rts::SystemScheduler sScheduler;
+
+// Scratch memory of the current frame. Released after every 'cbz::Frame()'.
+static rts::FrameArena sFrameArena;
+static rts::QueryCache<Position, Rotation, Camera> sCameraQuery;
+
+// Change tick of the last camera update
+static uint64_t sCameraChangeTick;
+
+// Frame time not yet simulated by 'rts::Step'
+static float sStepTime;
+
+// Steps simulated at most per frame. Stalls beyond are dropped.
+static constexpr uint32_t sMaxStepsPerFrame = 4;
+
+// @brief Calls the 'on_hit(self, damage, target, source)' callback of the unit
+// script of every unit damaged in the last 'rts::Step'.
+static void GameEventsDispatch() {
+  for (const rts::GameEvent &event : rts::GetGameEvents()) {
+    if (event.type != rts::GAME_EVENT_TYPE_DAMAGE ||
+        event.target == UNIT_ID_INVALID) {
+      continue;
+    }
+
+    sol::table script =
+        sAssetManager->getUnitScript(rts::GetUnitAssetId(event.target));
+    if (!script.valid()) {
+      continue;
+    }
+
+    sol::optional<sol::protected_function> onHit = script["on_hit"];
+    if (!onHit) {
+      continue;
+    }
+
+    sol::protected_function_result res =
+        (*onHit)(script, event.amount, event.target, event.source);
+    if (!res.valid()) {
+      sol::error err = res;
+      spdlog::error("Lua Run Error: {}", err.what());
+    }
+  }
+}
+
 static void OnImGuiRender() {
   sBuiltInRenderPipeline->onImGuiRender();
   sDebugRendererPipeline->onImGuiRender();
@@ -95,6 +160,10 @@ static void OnImGuiRender() {
   ImGui::SameLine();
   cbz::imgui::Image(flowFieldTexture, ImVec2(width, avail.y));
   ImGui::End();
+
+  ImGui::Begin("Minimap");
+  cbz::imgui::Image(minimapTexture, ImGui::GetContentRegionAvail());
+  ImGui::End();
 }
 
 namespace cbz {
@@ -128,134 +197,163 @@ EditorApplication::EditorApplication(const char *name,
 #endif
 
   // --- Reset time ---
+  sStartTime = std::chrono::steady_clock::now();
   sLastTime = 0.0f;
-  sTime = 1.0f;
+  sTime = 0.0f;
   sDeltaTime = 0.001f;
+  sStepTime = 0.0f;
 
   sAssetManager = std::make_unique<AssetManager>(sLua);
 
   // --- Client Systems ---
   sWorld = std::unique_ptr<cbz::ecs::IWorld>(cbz::ecs::InitWorld());
 
-  // Tranform Hierarchy
+  rts::FrameArenaInit(&sFrameArena);
+  rts::JobSystemInit(&sJobSystem,
+                     std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+  // Systems run as a dependency graph. Anything touching the GPU stays on
+  // the main thread.
+  rts::SystemSchedulerInit(&sScheduler, &sJobSystem);
   sWorld->system([](ecs::IWorld *world) {
-    struct TransformData {
-      Position *pos;
-      Rotation *rot;
-      Scale *scale;
-      Transform *t;
+    rts::SystemSchedulerRun(&sScheduler, world);
+  });
 
-      cbz::ecs::EntityId eId;
-    };
+  // Tranform Hierarchy
+  sTransformHierarchy =
+      std::make_unique<TransformHierarchy>(sWorld.get(), &sJobSystem);
+  rts::SystemDesc transforms;
+  transforms.name = "TransformHierarchy";
+  transforms.access = rts::SystemReads<Position, Rotation, Scale>() |
+                      rts::SystemWrites<Transform, TransformHierarchy>();
+  transforms.flags = rts::SYSTEM_FLAGS_NONE;
+  transforms.prepare = [](ecs::IWorld *) { sTransformHierarchy->refresh(); };
+  transforms.fn = [](ecs::IWorld *) {
+    sTransformHierarchy->update();
+    for (uint32_t i = 0; i < sTransformHierarchy->getUpdatedCount(); i++) {
+      rts::SystemSchedulerMarkChanged<Transform>(
+          &sScheduler, sTransformHierarchy->getUpdatedEntity(i));
+    }
+  };
+  rts::SystemSchedulerAdd(&sScheduler, transforms);
 
-    // TODO: not make static to be thread safe
-    static std::vector<TransformData> sTransformData;
-    sTransformData.clear();
-
-    world->query<cbz::ecs::Entity, Position, Rotation, Scale, Transform>(
-        [](cbz::ecs::Entity e, Position &pos, Rotation &rot, Scale &scale,
-           Transform &t) {
-          sTransformData.push_back({&pos, &rot, &scale, &t, e});
-        });
-
-    // Topological sort by ascending depth and parent
-    std::sort(sTransformData.begin(), sTransformData.end(),
-              [](const TransformData &a, const TransformData &b) {
-                if (a.t->getDepth() != b.t->getDepth()) {
-                  return a.t->getDepth() < b.t->getDepth();
-                }
-
-                return a.t->getParent().getId() < b.t->getParent().getId();
-              });
-
-    for (TransformData &tData : sTransformData) {
-      glm::mat4 parentTransform = glm::mat4(1.0f);
-
-      if (tData.t->getParent()) {
-        parentTransform = cbz::ecs::Entity(tData.t->getParent())
-                              .getComponent<Transform>()
-                              .get();
+  // Local Illumination. Only lights that moved or changed type are updated.
+  static_assert(sizeof(LightSource) % CBZ_UNIFORM_SIZE_VEC4 == 0);
+  auto lightUpdate = [](const Position &position, const Rotation &rotation,
+                        const Transform &transform, LightSource &lightSrc) {
+    if (!lightSrc.uh) {
+      if (lightSrc.castShadows) {
+        // Make shadow map
       }
 
-      glm::mat4 S = glm::scale(glm::mat4(1.0f), glm::vec3(*tData.scale));
-      glm::mat4 T = glm::translate(glm::mat4(1.0f), glm::vec3(*tData.pos));
-      glm::mat4 R = glm::mat4_cast(glm::quat(*tData.rot));
-      tData.t->set(parentTransform * T * R * S);
+      switch (lightSrc.type) {
+      case LIGHT_TYPE_DIRECTIONAL: {
+        static_assert(
+            sizeof(LightSource::properties) % CBZ_UNIFORM_SIZE_VEC4 == 0);
+        lightSrc.uh = cbz::UniformCreate("uDirLight", CBZ_UNIFORM_TYPE_VEC4,
+                                         sizeof(LightSource::properties) /
+                                             CBZ_UNIFORM_SIZE_VEC4);
+      } break;
+      case LIGHT_TYPE_POINT: {
+      } break;
+      case LIGHT_TYPE_COUNT:
+        break;
+      }
     }
-  });
 
-  // Local Illumination
-  static_assert(sizeof(LightSource) % CBZ_UNIFORM_SIZE_VEC4 == 0);
-  sWorld->system_for_each<Position, Rotation, Transform, LightSource>(
-      [](const Position &position, const Rotation &rotation,
-         const Transform &transform, LightSource &lightSrc) {
-        if (!lightSrc.uh) {
-          if (lightSrc.castShadows) {
-            // Make shadow map
-          }
-
-          switch (lightSrc.type) {
-          case LIGHT_TYPE_DIRECTIONAL: {
-            static_assert(
-                sizeof(LightSource::properties) % CBZ_UNIFORM_SIZE_VEC4 == 0);
-            lightSrc.uh = cbz::UniformCreate("uDirLight", CBZ_UNIFORM_TYPE_VEC4,
-                                             sizeof(LightSource::properties) /
-                                                 CBZ_UNIFORM_SIZE_VEC4);
-          } break;
-          case LIGHT_TYPE_POINT: {
-          } break;
-          case LIGHT_TYPE_COUNT:
-            break;
-          }
-        }
+    lightSrc.properties.position[0] = position.x;
+    lightSrc.properties.position[1] = position.y;
+    lightSrc.properties.position[2] = position.z;
 
-        lightSrc.properties.position[0] = position.x;
-        lightSrc.properties.position[1] = position.y;
-        lightSrc.properties.position[2] = position.z;
+    glm::vec3 forward = glm::quat(rotation) * glm::vec3(0.0f, 0.0f, -1.0f);
+    lightSrc.properties.direction[0] = forward.x;
+    lightSrc.properties.direction[1] = forward.y;
+    lightSrc.properties.direction[2] = forward.z;
 
-        glm::vec3 forward = glm::quat(rotation) * glm::vec3(0.0f, 0.0f, -1.0f);
-        lightSrc.properties.direction[0] = forward.x;
-        lightSrc.properties.direction[1] = forward.y;
-        lightSrc.properties.direction[2] = forward.z;
+    memcpy(lightSrc.properties.lightSpaceMatrix,
+           glm::value_ptr(transform.get()), sizeof(float) * 16);
+  };
 
-        memcpy(lightSrc.properties.lightSpaceMatrix,
-               glm::value_ptr(transform.get()), sizeof(float) * 16);
-      });
+  struct LightSystemState {
+    rts::QueryCache<Position, Rotation, Transform, LightSource> cache;
+    uint64_t lastRunTick = 0;
+  };
+  auto lightState = std::make_shared<LightSystemState>();
+
+  rts::SystemDesc lights;
+  lights.name = "LocalIllumination";
+  lights.access = rts::SystemFnTraits<decltype(lightUpdate)>::Access();
+  lights.flags = rts::SYSTEM_FLAGS_MAIN_THREAD;
+  lights.prepare = [lightState](ecs::IWorld *world) {
+    // Rebuilt caches visit every light once
+    if (rts::QueryCacheUpdate(&lightState->cache, world)) {
+      lightState->lastRunTick = 0;
+    }
+  };
+  lights.fn = [lightUpdate, lightState](ecs::IWorld *world) {
+    rts::QueryCacheForEachChanged(
+        &lightState->cache, world,
+        {rts::SystemSchedulerChanges<Transform>(&sScheduler),
+         rts::SystemSchedulerChanges<LightSource>(&sScheduler)},
+        lightState->lastRunTick, lightUpdate);
+    lightState->lastRunTick = sScheduler.changeTick;
+  };
+  rts::SystemSchedulerAdd(&sScheduler, lights);
 
   sBuiltInRenderPipeline =
       std::make_unique<BuiltInRenderPipeline>(mWidth, mHeight);
+
+  // Renderables
+  sStaticMeshRenderer = std::make_unique<StaticMeshRenderer>();
+
 #ifdef CBZ_DEBUG
-  sDebugRendererPipeline =
-      std::make_unique<DebugRenderPipeline>(sWorld.get(), mWidth, mHeight);
+  sDebugRendererPipeline = std::make_unique<DebugRenderPipeline>(
+      sWorld.get(), sTransformHierarchy.get(), &sScheduler,
+      sStaticMeshRenderer.get(), mWidth, mHeight);
 
   // Render picking objects
-  sWorld->system_for_each<Transform, Primitive>(
-      [](Transform &transform, Primitive &mesh) {
+  rts::SystemSchedulerAddForEach<Transform, Primitive>(
+      &sScheduler, "RenderPickables",
+      [](const Transform &transform, const Primitive &mesh) {
         sDebugRendererPipeline->renderPickable(sCamera, transform, mesh);
-      });
+      },
+      rts::SYSTEM_FLAGS_MAIN_THREAD);
 #endif //  CBZ_DEBUG
 
-  // Renderables
-  sStaticMeshRenderer = std::make_unique<StaticMeshRenderer>();
-
   // TODO: Light environment as ssbo and non static
   static LightSource lightEnv = {};
   static uint32_t lightCount = 1;
   static Skybox skybox = {};
-  sWorld->system_for_each<LightSource>(
-      [](LightSource &lightSource) { lightEnv = lightSource; });
 
-  sWorld->system_for_each<Skybox>([](Skybox &sb) { skybox = sb; });
+  // Access keys of the copies above
+  struct LightEnvResource {};
+  struct SkyboxResource {};
 
-  sWorld->system_for_each<Transform, Primitive>(
+  rts::SystemSchedulerAddForEach<LightSource>(
+      &sScheduler, "LightEnvironment",
+      [](const LightSource &lightSource) { lightEnv = lightSource; },
+      rts::SYSTEM_FLAGS_NONE, rts::SystemWrites<LightEnvResource>());
+
+  rts::SystemSchedulerAddForEach<Skybox>(
+      &sScheduler, "Skybox", [](const Skybox &sb) { skybox = sb; },
+      rts::SYSTEM_FLAGS_NONE, rts::SystemWrites<SkyboxResource>());
+
+  rts::SystemSchedulerAddForEach<Transform, Primitive>(
+      &sScheduler, "StaticMeshes",
       [](Transform &transform, Primitive &primitive) {
         sStaticMeshRenderer->render(&sCamera, &skybox, &lightEnv, lightCount,
                                     &transform, &primitive);
-      });
+      },
+      rts::SYSTEM_FLAGS_MAIN_THREAD,
+      rts::SystemReads<LightEnvResource, SkyboxResource>());
 
   // RenderPipeline submission
-  sWorld->system(
-      [](ecs::IWorld *) { sBuiltInRenderPipeline->submit(sCamera); });
+  rts::SystemDesc submit;
+  submit.name = "Submit";
+  submit.access = {0, 0};
+  submit.flags = rts::SYSTEM_FLAGS_MAIN_THREAD;
+  submit.fn = [](ecs::IWorld *) { sBuiltInRenderPipeline->submit(sCamera); };
+  rts::SystemSchedulerAdd(&sScheduler, submit);
 
   // --- Define Lua bindings ---
   // Common libraries
@@ -289,6 +387,7 @@ EditorApplication::EditorApplication(const char *name,
     pos.x = x;
     pos.y = y;
     pos.z = z;
+    sTransformHierarchy->markDirty(eId);
   };
 
   sLua["scale"] = sLua.create_table();
@@ -302,6 +401,7 @@ EditorApplication::EditorApplication(const char *name,
     scale.x = x;
     scale.y = y;
     scale.z = z;
+    sTransformHierarchy->markDirty(eId);
   };
 
   sLua["rotation"] = sLua.create_table();
@@ -318,6 +418,7 @@ EditorApplication::EditorApplication(const char *name,
     rotation.x = x;
     rotation.y = y;
     rotation.z = z;
+    sTransformHierarchy->markDirty(eId);
   };
 
   sLua["rotation"]["set_euler"] = [](cbz::ecs::EntityId eId, float radX,
@@ -325,13 +426,15 @@ EditorApplication::EditorApplication(const char *name,
     Rotation &rotation =
         cbz::ecs::Entity(eId, sWorld.get()).getComponent<Rotation>();
     rotation.setEuler(radX, radY, radZ);
+    sTransformHierarchy->markDirty(eId);
   };
 
   // Assets
   sLua["gltf"] = sLua.create_table();
   sLua["gltf"]["load"] = [&](const char *path) {
     uint32_t assetId = sGltfs.size();
-    sGltfs.push_back(GltfAssetCreate(std::string(ASSET_DIR) + path));
+    sGltfs.push_back(GltfAssetCreate(std::string(ASSET_DIR) + path,
+                                     sStaticMeshRenderer.get()));
 
     if (sGltfs[assetId]->load() != cbz::Result::eSuccess) {
       spdlog::error("Failed to load gltf at {}", std::string(ASSET_DIR) + path);
@@ -349,13 +452,50 @@ EditorApplication::EditorApplication(const char *name,
     return EntityCreateFromGltf(sWorld.get(), sGltfs[assetId].get()).getId();
   };
 
+  // 'positions' holds x, y, z of each root. Returns the root ids.
+  auto spawnMany = [](uint32_t assetId, const std::vector<float> &positions,
+                      bool isStatic) {
+    std::vector<cbz::ecs::EntityId> out;
+    if (assetId >= sGltfs.size()) {
+      return out;
+    }
+
+    const uint32_t count = static_cast<uint32_t>(positions.size() / 3);
+    std::vector<Position> rootPositions(count);
+    for (uint32_t i = 0; i < count; i++) {
+      rootPositions[i] = {positions[i * 3 + 0], positions[i * 3 + 1],
+                          positions[i * 3 + 2]};
+    }
+
+    std::vector<cbz::ecs::Entity> roots(count);
+    EntitiesCreateFromGltf(sWorld.get(), sGltfs[assetId].get(), count,
+                           rootPositions.data(), roots.data(), isStatic);
+
+    out.reserve(count);
+    for (cbz::ecs::Entity root : roots) {
+      out.push_back(root.getId());
+    }
+    return out;
+  };
+
+  sLua["gltf"]["spawn_many"] =
+      [spawnMany](uint32_t assetId, const std::vector<float> &positions) {
+        return spawnMany(assetId, positions, false);
+      };
+
+  // Node transforms are baked into the primitives. Only the root can move.
+  sLua["gltf"]["spawn_static"] =
+      [spawnMany](uint32_t assetId, const std::vector<float> &positions) {
+        return spawnMany(assetId, positions, true);
+      };
+
   // Camera fns
   sLua["camera"] = sLua.create_table();
   sLua["camera"]["spawn"] = [this](const char *name) {
     cbz::ecs::Entity e = instantiate();
     e.setName(name);
 
-    Camera &camera = e.addComponent<Camera>();
+    Camera &camera = rts::QueryAddComponent<Camera>(sWorld.get(), e);
     camera.aspectRatio = 16.0 / 9.0;
     camera.fov = glm::radians(90.0f);
     camera.near = 0.1f;
@@ -383,7 +523,8 @@ EditorApplication::EditorApplication(const char *name,
   sLua["lights"]["spawn_directional"] = [this](const char *name) {
     cbz::ecs::Entity e = instantiate();
     e.setName(name);
-    e.addComponent<LightSource>().type = LIGHT_TYPE_DIRECTIONAL;
+    rts::QueryAddComponent<LightSource>(sWorld.get(), e).type =
+        LIGHT_TYPE_DIRECTIONAL;
     return e.getId();
   };
 
@@ -402,7 +543,8 @@ EditorApplication::EditorApplication(const char *name,
   sLua["point_light_spawn"] = [this](const char *name) {
     cbz::ecs::Entity e = instantiate();
     e.setName(name);
-    e.addComponent<LightSource>().type = LIGHT_TYPE_POINT;
+    rts::QueryAddComponent<LightSource>(sWorld.get(), e).type =
+        LIGHT_TYPE_POINT;
   };
 
   sLua["point_light_set_color"] = [](cbz::ecs::EntityId eId, float r, float g,
@@ -417,6 +559,95 @@ EditorApplication::EditorApplication(const char *name,
     e.getComponent<LightSource>().properties.intensity[2] = {b};
   };
 
+  sLua["combat"] = sLua.create_table();
+  sLua["combat"]["status"] =
+      sLua.create_table_with("bleed", rts::STATUS_EFFECT_TYPE_BLEED, "rot",
+                             rts::STATUS_EFFECT_TYPE_ROT);
+
+  sLua["combat"]["inc_status"] = [](rts::unitId target, uint32_t status) {
+    if (status >= rts::STATUS_EFFECT_TYPE_COUNT) {
+      return;
+    }
+
+    rts::StatusEffectApply(rts::GetStatusEffects(), target,
+                           static_cast<rts::StatusEffectType>(status));
+  };
+
+  sLua["combat"]["is_status"] = [](rts::unitId target, uint32_t status) {
+    if (status >= rts::STATUS_EFFECT_TYPE_COUNT) {
+      return false;
+    }
+
+    return rts::StatusEffectGetStacks(
+               rts::GetStatusEffects(), target,
+               static_cast<rts::StatusEffectType>(status)) > 0;
+  };
+
+  // Selection
+  sLua["units"] = sLua.create_table();
+  sLua["units"]["select_box"] = [](float x0, float y0, float x1, float y1) {
+    glm::mat4 viewProj =
+        glm::make_mat4(sCamera.proj) * glm::make_mat4(sCamera.view);
+
+    // Window pixels to NDC, 'y' up
+    const auto toNdc = [](float x, float y) {
+      return rts::Vec2{2.0f * x / mWidth - 1.0f, 1.0f - 2.0f * y / mHeight};
+    };
+
+    std::vector<rts::unitId> units;
+    rts::SelectUnitsInRect(rts::GetUnitGrid(), glm::value_ptr(viewProj),
+                           toNdc(x0, y0), toNdc(x1, y1), &units);
+    return units;
+  };
+
+  // Obstacles. 'x', 'z' is the world position of the footprint's center.
+  sLua["obstacles"] = sLua.create_table();
+  sLua["obstacles"]["spawn"] = [](float x, float z, uint8_t width,
+                                  uint8_t height, sol::optional<int> cost) {
+    rts::Footprint footprint;
+    footprint.width = width;
+    footprint.height = height;
+    footprint.cost = cost.value_or(COST_IMPASSABLE);
+    return rts::SpawnObstacle({x, 0.0f, z}, footprint);
+  };
+  sLua["obstacles"]["despawn"] = [](rts::obstacleId obstacle) {
+    rts::DespawnObstacle(obstacle);
+  };
+
+  // Terrain. 'x0', 'z0' and 'x1', 'z1' are world positions of opposite
+  // corners of the filled area.
+  sLua["terrain"] = sLua.create_table();
+  sLua["terrain"]["type"] =
+      sLua.create_table_with("ground", CELL_TYPE_GROUND, "mud", CELL_TYPE_MUD,
+                             "water", CELL_TYPE_WATER);
+  sLua["terrain"]["fill"] = [](float x0, float z0, float x1, float z1,
+                               uint32_t type) {
+    if (type == CELL_TYPE_NONE || type >= CELL_TYPE_COUNT) {
+      return;
+    }
+
+    const rts::IVec2 a = rts::WorldToCell({x0, 0.0f, z0});
+    const rts::IVec2 b = rts::WorldToCell({x1, 0.0f, z1});
+
+    rts::CellRect rect;
+    rect.min = {std::clamp(std::min(a.x, b.x), 0, GRID_X - 1),
+                std::clamp(std::min(a.y, b.y), 0, GRID_Y - 1)};
+    rect.max = {std::clamp(std::max(a.x, b.x), 0, GRID_X - 1),
+                std::clamp(std::max(a.y, b.y), 0, GRID_Y - 1)};
+    rts::CostFieldFillTerrain(rts::GetCostField(), rect,
+                              static_cast<CellType>(type));
+  };
+
+  // --- Game ---
+  // Initialized before the level script so it can place units and obstacles
+  if (sAssetManager->loadUnitTable(ASSET_DIR "scripts/units",
+                                   CACHE_DIR "units.bin") !=
+      cbz::Result::eSuccess) {
+    spdlog::error("Failed to load unit table");
+  }
+
+  rts::Init(&sJobSystem);
+
   // Laod scripts
   sol::load_result script = sLua.load_file(ASSET_DIR "scripts/init.lua");
   if (!script.valid()) {
@@ -447,9 +678,6 @@ EditorApplication::EditorApplication(const char *name,
     exit(0); // TODO: Recover
   }
 
-  // --- Game ---
-  rts::Init();
-
   // TODO: Clean up and destroy
   costFieldTexture = cbz::Image2DCreate(CBZ_TEXTURE_FORMAT_RGBA8UNORM,
                                         static_cast<uint32_t>(GRID_X),
@@ -463,6 +691,11 @@ EditorApplication::EditorApplication(const char *name,
                                         static_cast<uint32_t>(GRID_X),
                                         static_cast<uint32_t>(GRID_Y));
 
+  rts::MinimapInit(&sMinimap);
+  minimapTexture = cbz::Image2DCreate(CBZ_TEXTURE_FORMAT_RGBA8UNORM,
+                                      static_cast<uint32_t>(MINIMAP_X),
+                                      static_cast<uint32_t>(MINIMAP_Y));
+
   flowFieldShader =
       cbz::ShaderCreate("assets/shaders/flow_field.wgsl", CBZ_SHADER_WGLSL);
   cbz::ShaderSetName(flowFieldShader, "flow_field", strlen("flow_field"));
@@ -484,13 +717,16 @@ EditorApplication::EditorApplication(const char *name,
 
   cbz::ecs::Entity flowField = instantiate();
   flowField.setName("flowField");
-  Primitive &primitive = flowField.addComponent<Primitive>();
+  Primitive &primitive =
+      rts::QueryAddComponent<Primitive>(sWorld.get(), flowField);
   primitive.vbh = QuadVBH;
   primitive.ibh = QuadIBH;
-  primitive.materialRef.textureCount = 1;
-  primitive.materialRef.ph = flowFieldProgram;
-  primitive.materialRef.textures[MATERIAL_TEXTURE_PRIMARY] = {
-      NULL, integrationFieldTexture};
+
+  Material material = {};
+  material.textureCount = 1;
+  material.ph = flowFieldProgram;
+  material.textures[MATERIAL_TEXTURE_PRIMARY] = {NULL, integrationFieldTexture};
+  primitive.material = sStaticMeshRenderer->addMaterial(material);
 }
 
 EditorApplication::~EditorApplication() {
@@ -504,9 +740,13 @@ EditorApplication::~EditorApplication() {
   cbz::ImageDestroy(flowFieldTexture);
   cbz::ImageDestroy(integrationFieldTexture);
   cbz::ImageDestroy(costFieldTexture);
+  cbz::ImageDestroy(minimapTexture);
 
   // Clean up
+  rts::SystemSchedulerShutdown(&sScheduler);
   rts::Shutdown();
+  rts::JobSystemShutdown(&sJobSystem);
+  rts::FrameArenaShutdown(&sFrameArena);
   cbz::Shutdown();
   sDeltaTime = 0;
 }
@@ -516,41 +756,68 @@ cbz::ecs::Entity EditorApplication::instantiate(const Position &position,
                                                 const Rotation &rotation,
                                                 const char *name) {
   cbz::ecs::Entity out = sWorld->instantiate(name);
-  out.addComponent<Position>(position);
-  out.addComponent<Scale>(scale);
-  out.addComponent<Rotation>(rotation);
+  rts::QueryAddComponent<Position>(sWorld.get(), out, position);
+  rts::QueryAddComponent<Scale>(sWorld.get(), out, scale);
+  rts::QueryAddComponent<Rotation>(sWorld.get(), out, rotation);
 
   glm::mat4 matrix = {};
   matrix = glm::translate(matrix, glm::vec3(position));
   matrix = glm::mat4_cast(glm::quat(rotation)) * matrix;
   matrix = glm::scale(matrix, glm::vec3(scale));
 
-  out.addComponent<Transform>().set(matrix);
+  rts::QueryAddComponent<Transform>(sWorld.get(), out).set(matrix);
   return out;
 }
 
 void EditorApplication::update() {
+  sTime = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+                                       sStartTime)
+              .count();
+  sDeltaTime = sTime - sLastTime;
+  sLastTime = sTime;
+
   // Update cameras
   bool hasCamera = false;
-  sWorld->query<Position, Rotation, Camera>(
-      [&](Position &pos, Rotation &rot, Camera &camera) {
+  const bool isCameraQueryRebuilt =
+      rts::QueryCacheUpdate(&sCameraQuery, sWorld.get());
+  const uint64_t cameraSinceTick =
+      isCameraQueryRebuilt ? 0 : sCameraChangeTick;
+  rts::QueryCacheForEach(
+      &sCameraQuery, sWorld.get(),
+      [&](cbz::ecs::Entity e, const Position &pos, const Rotation &rot,
+          Camera &camera) {
         hasCamera = true;
-        camera.position[0] = pos.x;
-        camera.position[1] = pos.y;
-        camera.position[2] = pos.z;
 
-        glm::mat4 proj = glm::perspective(camera.fov, camera.aspectRatio,
-                                          camera.near, camera.far);
-        memcpy(camera.proj, glm::value_ptr(proj), sizeof(float) * 16);
-
-        glm::vec3 forward = glm::quat(rot) * glm::vec3(0.0f, 0.0f, -1.0f);
-        glm::mat4 view = glm::lookAt(glm::vec3(pos), glm::vec3(pos) + forward,
-                                     glm::vec3(0.0f, 1.0f, 0.0f));
-        memcpy(camera.view, glm::value_ptr(view), sizeof(float) * 16);
+        // Matrices only change with the camera's transform or settings
+        const bool isChanged =
+            cameraSinceTick == 0 ||
+            rts::ChangeTicksChangedSince(
+                rts::SystemSchedulerChanges<Transform>(&sScheduler),
+                e.getId(), cameraSinceTick) ||
+            rts::ChangeTicksChangedSince(
+                rts::SystemSchedulerChanges<Camera>(&sScheduler), e.getId(),
+                cameraSinceTick);
+
+        if (isChanged) {
+          camera.position[0] = pos.x;
+          camera.position[1] = pos.y;
+          camera.position[2] = pos.z;
+
+          glm::mat4 proj = glm::perspective(camera.fov, camera.aspectRatio,
+                                            camera.near, camera.far);
+          memcpy(camera.proj, glm::value_ptr(proj), sizeof(float) * 16);
+
+          glm::vec3 forward = glm::quat(rot) * glm::vec3(0.0f, 0.0f, -1.0f);
+          glm::mat4 view =
+              glm::lookAt(glm::vec3(pos), glm::vec3(pos) + forward,
+                          glm::vec3(0.0f, 1.0f, 0.0f));
+          memcpy(camera.view, glm::value_ptr(view), sizeof(float) * 16);
+        }
 
         // Store camera data
         sCamera = camera;
       });
+  sCameraChangeTick = sScheduler.changeTick;
 
   if (!hasCamera) {
     spdlog::warn("Game has no camera!");
@@ -568,7 +835,7 @@ void EditorApplication::update() {
   }
 
   // Editor
-  sDebugRendererPipeline->findPickables();
+  sDebugRendererPipeline->findPickables(&sFrameArena);
   if (cbz::IsMouseButtonPressed(cbz::MouseButton::eLeft)) {
     MousePosition mousePos = cbz::GetMousePosition();
     cbz::ecs::EntityId eId = sDebugRendererPipeline->getEntityAtMousePosition(
@@ -585,6 +852,26 @@ void EditorApplication::update() {
 
   // -- GAME --
 
+  // Fixed rate simulation. Leftover time carries over to the next frame.
+  sStepTime = std::min(sStepTime + sDeltaTime,
+                       sMaxStepsPerFrame * STEP_DELTA_TIME);
+  while (sStepTime >= STEP_DELTA_TIME) {
+    rts::Step();
+    sStepTime -= STEP_DELTA_TIME;
+
+    // Events are only valid until the next step
+    GameEventsDispatch();
+  }
+
+  // Minimap. Only uploaded when pixels changed.
+  rts::MinimapUpdate(&sMinimap, rts::GetCostField(), rts::GetUnitGrid(),
+                     sFrameCtr);
+  if (sMinimap.dirtyRowMin <= sMinimap.dirtyRowMax) {
+    cbz::Image2DUpdate(minimapTexture, sMinimap.pixels.data(),
+                       MINIMAP_X * MINIMAP_Y);
+    rts::MinimapClearDirtyRows(&sMinimap);
+  }
+
   // Visualize flow field
   if (cbz::IsMouseButtonPressed(cbz::MouseButton::eRight)) {
     const glm::ivec2 gridDimensions(GRID_X, GRID_Y);
@@ -594,14 +881,16 @@ void EditorApplication::update() {
 
     // TODO: Each field as colors
 
-    // Create Generate map
-    std::vector<int> costField(GRID_X * GRID_Y);
-    for (int i = 0; i < GRID_X * GRID_Y; i++) {
-      costField[i] = 1;
-    }
+    // Terrain and obstacles from the simulation
+    int *costField = rts::FrameArenaAllocArray<int>(&sFrameArena,
+                                                    GRID_X * GRID_Y);
+    std::copy_n(rts::GetCostField()->costs.data(), GRID_X * GRID_Y,
+                costField);
     costField[dstIdx] = 0;
 
-    std::vector<cbz::ColorRGBA> costFieldColors(GRID_X * GRID_Y);
+    cbz::ColorRGBA *costFieldColors =
+        rts::FrameArenaAllocArray<cbz::ColorRGBA>(&sFrameArena,
+                                                  GRID_X * GRID_Y);
     for (int i = 0; i < GRID_X * GRID_Y; i++) {
       float t = costField[i] / static_cast<float>(maxCost);
       costFieldColors[i].r = static_cast<uint8_t>(std::ceil(t * 255.0f));
@@ -614,16 +903,19 @@ void EditorApplication::update() {
       }
     }
 
-    cbz::Image2DUpdate(costFieldTexture, costFieldColors.data(),
-                       GRID_X * GRID_Y);
+    cbz::Image2DUpdate(costFieldTexture, costFieldColors, GRID_X * GRID_Y);
 
     // Create Integration field
-    std::vector<cbz::ColorRGBA> integrationFieldColors(GRID_X * GRID_Y);
-    std::vector<int> integrationField(GRID_X * GRID_Y);
-    rts::IntegrationFieldCreate(costField.data(), flowFieldTarget, GRID_X,
-                                integrationField.data());
+    cbz::ColorRGBA *integrationFieldColors =
+        rts::FrameArenaAllocArray<cbz::ColorRGBA>(&sFrameArena,
+                                                  GRID_X * GRID_Y);
+    int *integrationField =
+        rts::FrameArenaAllocArray<int>(&sFrameArena, GRID_X * GRID_Y);
+    rts::IntegrationFieldCreate(costField, flowFieldTarget, GRID_X,
+                                integrationField);
     for (int i = 0; i < GRID_X * GRID_Y; i++) {
-      float t = integrationField[i] / static_cast<float>(maxCost);
+      float t = integrationField[i] /
+                static_cast<float>(maxCost * STEP_COST_STRAIGHT);
       integrationFieldColors[i].r = static_cast<uint8_t>(std::ceil(t * 255.0f));
       integrationFieldColors[i].g = 255 - integrationFieldColors[i].r;
       integrationFieldColors[i].b = 0;
@@ -633,14 +925,17 @@ void EditorApplication::update() {
         integrationFieldColors[i] = {0, 0, 255, 255};
       }
     }
-    cbz::Image2DUpdate(integrationFieldTexture, integrationFieldColors.data(),
+    cbz::Image2DUpdate(integrationFieldTexture, integrationFieldColors,
                        GRID_X * GRID_Y);
 
     // Create flow field
-    std::vector<cbz::ColorRGBA> flowFieldColors(GRID_X * GRID_Y);
-    std::vector<rts::Vec2> flowField(GRID_X * GRID_Y);
-    rts::FlowFieldCreate(integrationField.data(), flowFieldTarget, GRID_X,
-                         flowField.data());
+    cbz::ColorRGBA *flowFieldColors =
+        rts::FrameArenaAllocArray<cbz::ColorRGBA>(&sFrameArena,
+                                                  GRID_X * GRID_Y);
+    rts::Vec2 *flowField =
+        rts::FrameArenaAllocArray<rts::Vec2>(&sFrameArena, GRID_X * GRID_Y);
+    rts::FlowFieldCreate(integrationField, flowFieldTarget, GRID_X,
+                         flowField);
 
     for (int i = 0; i < GRID_X * GRID_Y; i++) {
       flowFieldColors[i].r = (flowField[i].x * 0.5f + 1.0f) * 255;
@@ -653,12 +948,12 @@ void EditorApplication::update() {
       }
     }
 
-    cbz::Image2DUpdate(flowFieldTexture, flowFieldColors.data(),
-                       GRID_X * GRID_Y);
+    cbz::Image2DUpdate(flowFieldTexture, flowFieldColors, GRID_X * GRID_Y);
   }
 
   // Draw
   sFrameCtr = cbz::Frame();
+  rts::FrameArenaReset(&sFrameArena);
 }
 
 }; // namespace cbz
@@ -18,10 +18,17 @@
 
 #include <spdlog/spdlog.h>
 
+#include <glm/ext.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-static std::vector<std::unique_ptr<Asset<Material>>> sMaterials;
+#include <rts/rts_query.h>
+#include <rts/rts_unit_table.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
 static std::unordered_map<std::string, std::unique_ptr<Asset<TextureRef>>>
     sTextures;
 
@@ -78,6 +85,9 @@ public:
 
   cbz::Result load() override { return cbz::Result::eSuccess; }
 
+  // Material table entry shared by the primitives using this material
+  MaterialHandle tableHandle;
+
   // Uniform data
   MaterialPBRUniformData uData;
 
@@ -101,18 +111,18 @@ private:
 
 class PrimitiveAsset : public Asset<Primitive> {
 public:
-  PrimitiveAsset(const char *path, Material material)
-      : Asset(path), materialRef(material) {};
+  PrimitiveAsset(const char *path, MaterialHandle material)
+      : Asset(path), material(material) {};
   ~PrimitiveAsset() {};
 
   cbz::VertexBufferHandle vbh;
   cbz::IndexBufferHandle ibh;
 
-  Material materialRef;
+  MaterialHandle material;
 
   Primitive makeRef() override {
     ++mReferenceCount;
-    return {vbh, ibh, materialRef, this};
+    return {vbh, ibh, material};
   };
 
 private:
@@ -131,9 +141,6 @@ struct MeshReference {
       // Destroy owned resources
       cbz::VertexBufferDestroy(primitive.vbh);
       cbz::IndexBufferDestroy(primitive.ibh);
-
-      // Empty reference
-      primitive.materialRef = {};
     }
   }
 
@@ -145,6 +152,66 @@ public:
   int _;
 };
 
+// @brief Splits a matrix without shear into translation, rotation and scale.
+static void MatrixDecompose(const glm::mat4 &matrix, Position *outPosition,
+                            Rotation *outRotation, Scale *outScale) {
+  const glm::vec3 axes[3] = {glm::vec3(matrix[0]), glm::vec3(matrix[1]),
+                             glm::vec3(matrix[2])};
+
+  glm::vec3 scale(glm::length(axes[0]), glm::length(axes[1]),
+                  glm::length(axes[2]));
+
+  // Mirrored matrices keep a proper rotation by flipping one axis
+  if (glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f) {
+    scale.x = -scale.x;
+  }
+
+  // Zero-scale axes carry no direction. Rebuild them from the remaining axes
+  // so the rotation stays orthonormal instead of going NaN.
+  constexpr float epsilon = 1e-8f;
+  glm::mat3 basis(1.0f);
+  int degenerateCount = 0;
+  int validIdx = -1;
+  for (int i = 0; i < 3; i++) {
+    if (glm::abs(scale[i]) > epsilon) {
+      basis[i] = axes[i] / scale[i];
+      validIdx = i;
+    } else {
+      scale[i] = 0.0f;
+      degenerateCount++;
+    }
+  }
+
+  if (degenerateCount == 1) {
+    for (int i = 0; i < 3; i++) {
+      if (scale[i] == 0.0f) {
+        basis[i] = glm::normalize(
+            glm::cross(basis[(i + 1) % 3], basis[(i + 2) % 3]));
+      }
+    }
+  } else if (degenerateCount == 2) {
+    // Complete an orthonormal basis around the one remaining axis
+    const int i1 = (validIdx + 1) % 3;
+    const int i2 = (validIdx + 2) % 3;
+    glm::vec3 helper(0.0f);
+    helper[i1] = 1.0f;
+    if (glm::abs(glm::dot(helper, basis[validIdx])) > 0.9f) {
+      helper = glm::vec3(0.0f);
+      helper[i2] = 1.0f;
+    }
+    basis[i2] = glm::normalize(glm::cross(basis[validIdx], helper));
+    basis[i1] = glm::cross(basis[i2], basis[validIdx]);
+  } else if (degenerateCount == 3) {
+    basis = glm::mat3(1.0f);
+  }
+
+  const glm::quat rotation = glm::quat_cast(basis);
+
+  *outPosition = {matrix[3].x, matrix[3].y, matrix[3].z};
+  *outRotation = {rotation.w, rotation.x, rotation.y, rotation.z};
+  *outScale = {scale.x, scale.y, scale.z};
+}
+
 class GltfAsset : public Asset<Gltf> {
 public:
   struct Node {
@@ -165,14 +232,37 @@ public:
     std::string name;
   };
 
+  // Entity of the flattened hierarchy spawned for each copy of the asset
+  struct PrefabEntity {
+    std::string name;
+
+    // Index into 'prefab'. Parents come before their children.
+    int parentIdx;
+
+    Position position;
+    Rotation rotation;
+    Scale scale;
+
+    // Null for the root and nodes
+    PrimitiveAsset *primitive;
+  };
+
   std::vector<uint32_t> rootIndices;
   std::vector<Node> nodes;
 
+  // Root first, then nodes and their primitives breadth first
+  std::vector<PrefabEntity> prefab;
+
+  // Root and its primitives with the node transforms baked in, for geometry
+  // that never moves
+  std::vector<PrefabEntity> staticPrefab;
+
   std::vector<MeshReference> meshes;
   std::vector<MaterialPBRAsset> materials;
   std::vector<cbz::ImageHandle> images;
 
-  GltfAsset(std::filesystem::path path) : Asset(path) {};
+  GltfAsset(std::filesystem::path path, StaticMeshRenderer *renderer)
+      : Asset(path), mRenderer(renderer) {};
 
   ~GltfAsset() {
     for (cbz::ImageHandle imgh : images) {
@@ -309,6 +399,8 @@ public:
         material.textures[MATERIAL_PBR_TEXTURE_EMISSIVE] =
             TextureRef(this, sBlackIMGH);
       }
+
+      material.tableHandle = mRenderer->addMaterial(material.makeRef());
     }
 
     for (auto &fastgltfMesh : asset->meshes) {
@@ -327,7 +419,7 @@ public:
 
         MaterialPBRAsset *materialAsset = &materials[it->materialIndex.value()];
         PrimitiveAsset &primitive = outMesh.primitives.emplace_back(
-            fastgltfMesh.name.c_str(), materialAsset->makeRef());
+            fastgltfMesh.name.c_str(), materialAsset->tableHandle);
 
         auto *positionIt = it->findAttribute("POSITION");
 
@@ -506,6 +598,7 @@ public:
       loadNode(&asset.get(), nodeIndex, -1);
     }
 
+    buildPrefab();
     return cbz::Result::eSuccess;
   }
 
@@ -602,11 +695,87 @@ protected:
       loadNode(asset, childIndex, nodeIndex);
     }
   }
+
+  void buildPrefab() {
+    prefab.clear();
+    prefab.push_back({getName(), -1, {}, {}, {}, nullptr});
+
+    staticPrefab.clear();
+    staticPrefab.push_back({getName(), -1, {}, {}, {}, nullptr});
+
+    // Node matrices relative to the root by prefab index
+    std::vector<glm::mat4> nodeMatrices(1, glm::mat4(1.0f));
+
+    std::vector<std::vector<uint32_t>> children(nodes.size());
+    for (const Node &node : nodes) {
+      if (node.parentIndex != -1) {
+        children[node.parentIndex].push_back(node.index);
+      }
+    }
+
+    // Node index and prefab index of its parent
+    std::vector<std::pair<uint32_t, int>> queue;
+    for (uint32_t rootIdx : rootIndices) {
+      queue.push_back({rootIdx, 0});
+    }
+
+    for (size_t queueIdx = 0; queueIdx < queue.size(); queueIdx++) {
+      const Node &node = nodes[queue[queueIdx].first];
+      const int parentIdx = queue[queueIdx].second;
+      const int nodeEntityIdx = static_cast<int>(prefab.size());
+
+      const glm::mat4 nodeMatrix =
+          nodeMatrices[parentIdx] *
+          glm::translate(glm::mat4(1.0f),
+                         glm::vec3(node.translation[0], node.translation[1],
+                                   node.translation[2])) *
+          glm::mat4_cast(glm::quat(node.rotation[0], node.rotation[1],
+                                   node.rotation[2], node.rotation[3])) *
+          glm::scale(glm::mat4(1.0f),
+                     glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+
+      prefab.push_back(
+          {node.name, parentIdx,
+           Position{node.translation[0], node.translation[1],
+                    node.translation[2]},
+           Rotation{node.rotation[0], node.rotation[1], node.rotation[2],
+                    node.rotation[3]},
+           Scale{node.scale[0], node.scale[1], node.scale[2]}, nullptr});
+
+      nodeMatrices.resize(prefab.size(), glm::mat4(1.0f));
+      nodeMatrices[nodeEntityIdx] = nodeMatrix;
+
+      // Multiple primitives are created as individual entities
+      if (node.hasMesh) {
+        PrefabEntity bakedPrimitive = {};
+        MatrixDecompose(nodeMatrix, &bakedPrimitive.position,
+                        &bakedPrimitive.rotation, &bakedPrimitive.scale);
+
+        for (PrimitiveAsset &primitiveAsset :
+             meshes[node.meshIndex].primitives) {
+          prefab.push_back({primitiveAsset.getName(), nodeEntityIdx, {}, {},
+                            {}, &primitiveAsset});
+
+          bakedPrimitive.name = primitiveAsset.getName();
+          bakedPrimitive.parentIdx = 0;
+          bakedPrimitive.primitive = &primitiveAsset;
+          staticPrefab.push_back(bakedPrimitive);
+        }
+      }
+
+      for (uint32_t childIdx : children[node.index]) {
+        queue.push_back({childIdx, nodeEntityIdx});
+      }
+    }
+  }
+
+  // Owns the material table entries of 'materials'
+  StaticMeshRenderer *mRenderer;
 };
 
 [[nodiscard]] std::unique_ptr<Asset<Gltf>>
-GltfAssetCreate(const std::string &path) {
-  return std::make_unique<GltfAsset>(path);
+GltfAssetCreate(const std::string &path, StaticMeshRenderer *renderer) {
+  return std::make_unique<GltfAsset>(path, renderer);
 }
 
 StaticMeshRenderer::StaticMeshRenderer() {
@@ -649,6 +818,7 @@ void StaticMeshRenderer::render(const Camera *camera, const Skybox *skybox,
                                 const LightSource *lightSources, uint32_t count,
                                 Transform *transform, Primitive *primitive) {
   glm::mat4 globalTransform = transform->get();
+  const Material &material = mMaterials[primitive->material];
 
   cbz::TextureBindingDesc linearTexDesc = {};
   linearTexDesc.filterMode = CBZ_FILTER_MODE_LINEAR;
@@ -660,10 +830,9 @@ void StaticMeshRenderer::render(const Camera *camera, const Skybox *skybox,
     cbz::VertexBufferSet(primitive->vbh);
     cbz::IndexBufferSet(primitive->ibh);
 
-    cbz::TextureSet(
-        CBZ_TEXTURE_0,
-        primitive->materialRef.textures[MATERIAL_PBR_TEXTURE_ALBEDO].imgh,
-        linearTexDesc);
+    cbz::TextureSet(CBZ_TEXTURE_0,
+                    material.textures[MATERIAL_PBR_TEXTURE_ALBEDO].imgh,
+                    linearTexDesc);
 
     cbz::TransformSet(glm::value_ptr(globalTransform));
     cbz::ViewSet(camera->view);
@@ -690,11 +859,11 @@ void StaticMeshRenderer::render(const Camera *camera, const Skybox *skybox,
                     sizeof(lightSources[i].properties) / CBZ_UNIFORM_SIZE_VEC4);
   }
 
-  cbz::UniformSet(primitive->materialRef.uh, &primitive->materialRef.uData);
+  cbz::UniformSet(material.uh, &material.uData);
 
-  for (uint8_t i = 0; i < primitive->materialRef.textureCount; i++) {
-    cbz::TextureSet(CBZ_TEXTURE_SLOTS[i],
-                    primitive->materialRef.textures[i].imgh, linearTexDesc);
+  for (uint8_t i = 0; i < material.textureCount; i++) {
+    cbz::TextureSet(CBZ_TEXTURE_SLOTS[i], material.textures[i].imgh,
+                    linearTexDesc);
   }
 
   cbz::TextureBindingDesc linearCubeDesc = {};
@@ -707,68 +876,70 @@ void StaticMeshRenderer::render(const Camera *camera, const Skybox *skybox,
   cbz::ProjectionSet(camera->proj);
 
   // Forward rendered objects directly draw to the light pass
-  cbz::Submit(RENDER_PASS_TYPE_LIGHTING, primitive->materialRef.ph);
+  cbz::Submit(RENDER_PASS_TYPE_LIGHTING, material.ph);
 }
 
-// TODO: Make prefabs via lua. Including gltf creation resouces
-cbz::ecs::Entity EntityCreateFromGltf(cbz::ecs::IWorld *world,
-                                      Asset<Gltf> *asset) {
-  // TODO: This is confusing add a asset and reference type
-  GltfAsset *gltf = static_cast<GltfAsset *>(asset);
-
-  // Instantitate root entity
-  cbz::ecs::Entity out = world->instantiate(gltf->getName().c_str());
-  out.addComponent<Position>();
-  out.addComponent<Scale>();
-  out.addComponent<Rotation>();
-  out.addComponent<Transform>();
-
-  // Instantitate all nodes
-  std::vector<cbz::ecs::Entity> nodeEntities(gltf->nodes.size());
-  for (GltfAsset::Node &node : gltf->nodes) {
-    cbz::ecs::Entity e = nodeEntities[node.index] =
-        world->instantiate(node.name.c_str());
-
-    e.addComponent<Position>(node.translation[0], node.translation[1],
-                             node.translation[2]);
-    e.addComponent<Scale>(node.scale[0], node.scale[1], node.scale[2]);
-    e.addComponent<Rotation>(node.rotation[0], node.rotation[1],
-                             node.rotation[2], node.rotation[3]);
-
-    // Default parent
-    e.addComponent<Transform>().setParent(out);
-  }
+MaterialHandle StaticMeshRenderer::addMaterial(const Material &material) {
+  mMaterials.push_back(material);
+  return static_cast<MaterialHandle>(mMaterials.size() - 1);
+}
 
-  for (GltfAsset::Node &node : gltf->nodes) {
-    cbz::ecs::Entity e = nodeEntities[node.index];
+Material StaticMeshRenderer::getMaterial(MaterialHandle handle) const {
+  return mMaterials[handle];
+}
 
-    // Re parent if parent exists in node heirarchy
-    if (node.parentIndex != -1) {
-      e.getComponent<Transform>().setParent(nodeEntities[node.parentIndex]);
-    }
+void StaticMeshRenderer::clearMaterials() { mMaterials.clear(); }
 
-    // Skip if empty node
-    if (!node.hasMesh) {
-      continue;
-    }
+// TODO: Make prefabs via lua. Including gltf creation resouces
+cbz::ecs::Entity EntityCreateFromGltf(cbz::ecs::IWorld *world,
+                                      Asset<Gltf> *asset, bool isStatic) {
+  cbz::ecs::Entity out;
+  EntitiesCreateFromGltf(world, asset, 1, nullptr, &out, isStatic);
+  return out;
+}
 
-    // Multiple primitives are created as individual entities
-    for (PrimitiveAsset &primitiveAsset :
-         gltf->meshes[node.meshIndex].primitives) {
-      cbz::ecs::Entity primitiveEntity =
-          world->instantiate(primitiveAsset.getName().c_str());
-      primitiveEntity.addComponent<Primitive>(primitiveAsset.makeRef());
+void EntitiesCreateFromGltf(cbz::ecs::IWorld *world, Asset<Gltf> *asset,
+                            uint32_t count, const Position *positions,
+                            cbz::ecs::Entity *outRoots, bool isStatic) {
+  // TODO: This is confusing add a asset and reference type
+  GltfAsset *gltf = static_cast<GltfAsset *>(asset);
+  const std::vector<GltfAsset::PrefabEntity> &prefab =
+      isStatic ? gltf->staticPrefab : gltf->prefab;
+  const uint32_t prefabSize = static_cast<uint32_t>(prefab.size());
+
+  // Entity 'j' of copy 'i' is 'entities[i * prefabSize + j]'
+  std::vector<cbz::ecs::Entity> entities(count * prefabSize);
+
+  // One prefab entity at a time so parents exist before their children
+  for (uint32_t entityIdx = 0; entityIdx < prefabSize; entityIdx++) {
+    const GltfAsset::PrefabEntity &prefabEntity = prefab[entityIdx];
+
+    for (uint32_t i = 0; i < count; i++) {
+      cbz::ecs::Entity e = world->instantiate(prefabEntity.name.c_str());
+      rts::QueryAddComponent<Position>(world, e,
+                                       entityIdx == 0 && positions
+                                           ? positions[i]
+                                           : prefabEntity.position);
+      rts::QueryAddComponent<Scale>(world, e, prefabEntity.scale);
+      rts::QueryAddComponent<Rotation>(world, e, prefabEntity.rotation);
+
+      if (prefabEntity.primitive) {
+        rts::QueryAddComponent<Primitive>(world, e,
+                                          prefabEntity.primitive->makeRef());
+      }
 
-      primitiveEntity.addComponent<Position>();
-      primitiveEntity.addComponent<Scale>();
-      primitiveEntity.addComponent<Rotation>();
+      Transform &transform = rts::QueryAddComponent<Transform>(world, e);
+      if (prefabEntity.parentIdx != -1) {
+        transform.setParent(entities[i * prefabSize + prefabEntity.parentIdx]);
+      }
 
-      // Set node entity as parent
-      primitiveEntity.addComponent<Transform>().setParent(e);
+      entities[i * prefabSize + entityIdx] = e;
     }
   }
 
-  return out;
+  for (uint32_t i = 0; i < count; i++) {
+    outRoots[i] = entities[i * prefabSize];
+  }
 }
 
 TextureRef AssetManager::loadTexture(const std::string &path,
@@ -843,6 +1014,141 @@ TextureRef AssetManager::loadTexture(const std::string &path,
 //   return out;
 // }
 
+cbz::Result AssetManager::loadUnitTable(const std::string &scriptDir,
+                                        const std::string &cachePath) {
+  std::error_code ec;
+  std::vector<std::filesystem::path> scriptPaths;
+  for (const std::filesystem::directory_entry &entry :
+       std::filesystem::directory_iterator(scriptDir, ec)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".lua") {
+      scriptPaths.push_back(entry.path());
+    }
+  }
+
+  if (ec) {
+    spdlog::error("Failed to open unit scripts at {}", scriptDir);
+    return cbz::Result::eFileError;
+  }
+
+  // Directory order is unspecified
+  std::sort(scriptPaths.begin(), scriptPaths.end());
+
+  // Names are hashed too so adding or removing a script invalidates the cache
+  std::vector<std::string> sources;
+  uint64_t sourceHash = UNIT_TABLE_HASH_SEED;
+  for (const std::filesystem::path &path : scriptPaths) {
+    std::ifstream file(path, std::ios::binary);
+    std::string source((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+    std::string fileName = path.filename().string();
+
+    sourceHash =
+        rts::UnitTableHash(fileName.data(), fileName.size(), sourceHash);
+    sourceHash = rts::UnitTableHash(source.data(), source.size(), sourceHash);
+    sources.push_back(std::move(source));
+  }
+
+  rts::UnitTable *table = rts::GetUnitTable();
+
+  // Definitions are run again in the editor state so their callbacks can use
+  // its bindings. Each gets its own environment so globals it assigns stay out
+  // of the level script.
+  auto bindScripts = [&]() {
+    mUnitScripts.assign(table->archetypes.size(), sol::table());
+    for (size_t i = 0; i < scriptPaths.size(); i++) {
+      sol::environment env(mLua, sol::create, mLua.globals());
+      sol::protected_function_result res =
+          mLua.safe_script(sources[i], env, sol::script_pass_on_error,
+                           scriptPaths[i].string());
+      if (!res.valid() || res.get_type() != sol::type::table) {
+        continue;
+      }
+
+      sol::table definition = res;
+      std::string name =
+          definition.traverse_get<sol::optional<std::string>>("description",
+                                                              "name")
+              .value_or(scriptPaths[i].stem().string());
+      UnitAssetId id = rts::UnitTableFind(table, name.c_str());
+      if (id.idx != UNIT_ASSET_ID_INVALID) {
+        mUnitScripts[id.idx] = definition;
+      }
+    }
+  };
+
+  if (rts::UnitTableRead(table, cachePath.c_str(), sourceHash) ==
+      cbz::Result::eSuccess) {
+    spdlog::info("Loaded {} unit archetypes from {}", table->archetypes.size(),
+                 cachePath);
+    bindScripts();
+    return cbz::Result::eSuccess;
+  }
+
+  // Definitions are evaluated in their own state so they cannot clobber the
+  // globals of level scripts
+  sol::state lua;
+  lua.open_libraries(sol::lib::base, sol::lib::math);
+
+  rts::UnitTableInit(table, sourceHash);
+  for (size_t i = 0; i < scriptPaths.size(); i++) {
+    sol::protected_function_result res = lua.safe_script(
+        sources[i], sol::script_pass_on_error, scriptPaths[i].string());
+    if (!res.valid()) {
+      sol::error err = res;
+      spdlog::error("Lua Run Error: {}", err.what());
+      continue;
+    }
+
+    if (res.get_type() != sol::type::table) {
+      continue;
+    }
+
+    sol::table definition = res;
+    if (definition["type"].get_or(std::string()) != "unit") {
+      continue;
+    }
+
+    std::string name =
+        definition.traverse_get<sol::optional<std::string>>("description",
+                                                            "name")
+            .value_or(scriptPaths[i].stem().string());
+    sol::optional<sol::table> stats = definition["stats"];
+
+    auto stat = [&](const char *key) {
+      return stats ? static_cast<real_t>((*stats)[key].get_or(0.0)) : 0;
+    };
+
+    Unit unit = {};
+    unit.name = name.c_str();
+    unit.health = stat("health");
+    unit.mana = stat("mana");
+    unit.damage = stat("damage");
+    unit.armor = stat("armor");
+    unit.movement_speed = stat("movement_speed");
+    (void)rts::UnitTableAdd(table, unit);
+  }
+
+  spdlog::info("Compiled {} unit archetypes from {}", table->archetypes.size(),
+               scriptDir);
+
+  std::filesystem::create_directories(
+      std::filesystem::path(cachePath).parent_path(), ec);
+  if (rts::UnitTableWrite(table, cachePath.c_str()) != cbz::Result::eSuccess) {
+    spdlog::warn("Failed to write unit table cache {}", cachePath);
+  }
+
+  bindScripts();
+  return cbz::Result::eSuccess;
+}
+
+sol::table AssetManager::getUnitScript(UnitAssetId id) const {
+  if (id.idx >= mUnitScripts.size()) {
+    return sol::table();
+  }
+
+  return mUnitScripts[id.idx];
+}
+
 AssetManager::AssetManager(sol::state &luaState) : mLua(luaState) {
   mLua.create_table("material");
 
@@ -1,4 +1,5 @@
 #include "renderer/cubozoa_render_graph.h"
+#include "renderer/cubozoa_gltf.h"
 
 #include <cbz_gfx/cbz_gfx.h>
 #include <cbz_gfx/cbz_gfx_imgui.h>
@@ -501,21 +502,24 @@ static void DrawRecursive(cbz::ecs::Entity e) {
   }
 }
 
-DebugRenderPipeline::DebugRenderPipeline(cbz::ecs::IWorld *world, uint32_t w,
-                                         uint32_t h)
-    : mWorld(world) {
+DebugRenderPipeline::DebugRenderPipeline(
+    cbz::ecs::IWorld *world, TransformHierarchy *transformHierarchy,
+    rts::SystemScheduler *scheduler, StaticMeshRenderer *staticMeshRenderer,
+    uint32_t w, uint32_t h)
+    : mWorld(world), mTransformHierarchy(transformHierarchy),
+      mScheduler(scheduler), mStaticMeshRenderer(staticMeshRenderer) {
   mStencilPickerShader =
       cbz::ShaderCreate("assets/shaders/stencilPicker.wgsl", CBZ_SHADER_WGLSL);
   mStencilPickerProgram = cbz::GraphicsProgramCreate(mStencilPickerShader);
   // TODO: Move to application
   [[maybe_unused]] static int _ = [this]() {
     static cbz::ecs::Entity skyBox = mWorld->instantiate("Skybox");
-    skyBox.addComponent<Position>();
-    skyBox.addComponent<Rotation>();
-    skyBox.addComponent<Scale>();
-    skyBox.addComponent<Transform>();
+    rts::QueryAddComponent<Position>(mWorld, skyBox);
+    rts::QueryAddComponent<Rotation>(mWorld, skyBox);
+    rts::QueryAddComponent<Scale>(mWorld, skyBox);
+    rts::QueryAddComponent<Transform>(mWorld, skyBox);
 
-    Skybox &sb = skyBox.addComponent<Skybox>();
+    Skybox &sb = rts::QueryAddComponent<Skybox>(mWorld, skyBox);
     sb.irradianceCubeMap = irradianceCubeMapIMGH;
     sb.skyboxCubeMap = cubeMapIMGH;
     sb.hdriMap = hdriIMGH;
@@ -532,7 +536,7 @@ DebugRenderPipeline::~DebugRenderPipeline() {
   }
 }
 
-void DebugRenderPipeline::findPickables() {
+void DebugRenderPipeline::findPickables(rts::FrameArena *frameArena) {
   static int staggeredCtr = 24;
 
   if (staggeredCtr++ % 24 != 0) {
@@ -540,28 +544,26 @@ void DebugRenderPipeline::findPickables() {
   }
 
   // Update visible entity storage buffer for picking
-  static std::vector<cbz::ecs::EntityId> mVisible;
-  mVisible.clear();
+  rts::FrameVector<cbz::ecs::EntityId> visible(
+      rts::FrameAllocator<cbz::ecs::EntityId>{frameArena});
 
   mWorld->query<cbz::ecs::Entity, Primitive>(
-      [](cbz::ecs::Entity e, [[maybe_unused]] const Primitive &_) {
-        mVisible.push_back(e.getId());
+      [&visible](cbz::ecs::Entity e, [[maybe_unused]] const Primitive &_) {
+        visible.push_back(e.getId());
       });
 
-  if ((mVisible.capacity() * sizeof(cbz::ecs::EntityId) %
-       CBZ_UNIFORM_SIZE_VEC4) != 0) {
-    mVisible.reserve((mVisible.capacity() + (CBZ_UNIFORM_SIZE_VEC4 - 1)) &
-                     ~((CBZ_UNIFORM_SIZE_VEC4 - 1)));
-  }
-
-  if (mVisible.size() > 0) {
+  if (visible.size() > 0) {
     uint32_t bufferIdx =
-        (mVisible.size() * sizeof(cbz::ecs::EntityId)) / CBZ_UNIFORM_SIZE_VEC4;
+        (visible.size() * sizeof(cbz::ecs::EntityId)) / CBZ_UNIFORM_SIZE_VEC4;
 
-    uint32_t offset = mVisible.size() % CBZ_UNIFORM_SIZE_VEC4;
+    uint32_t offset = visible.size() % CBZ_UNIFORM_SIZE_VEC4;
     uint32_t elemCount = bufferIdx + (offset > 0 ? 1 : 0);
+
+    // Whole vec4s are uploaded
+    visible.resize(elemCount * CBZ_UNIFORM_SIZE_VEC4 /
+                   sizeof(cbz::ecs::EntityId));
     cbz::StructuredBufferUpdate(sPickableEntitiesSBH, elemCount,
-                                mVisible.data());
+                                visible.data());
   }
 
   cbz::MousePosition pos = cbz::GetMousePosition();
@@ -660,9 +662,11 @@ void DebugRenderPipeline::onImGuiRender() {
 
       if (ImGui::CollapsingHeader(sEntityLabel.c_str(), nullptr,
                                   ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui::DragFloat3("Position",
-                          &sFocusedEntity.getComponent<Position>().x);
-        ImGui::DragFloat3("Scale", &sFocusedEntity.getComponent<Scale>().x);
+        bool isTransformChanged = false;
+        isTransformChanged |= ImGui::DragFloat3(
+            "Position", &sFocusedEntity.getComponent<Position>().x);
+        isTransformChanged |= ImGui::DragFloat3(
+            "Scale", &sFocusedEntity.getComponent<Scale>().x);
 
         // Get current rotation quaternion
         glm::quat q = glm::quat(sFocusedEntity.getComponent<Rotation>());
@@ -695,6 +699,11 @@ void DebugRenderPipeline::onImGuiRender() {
           sFocusedEntity.getComponent<Rotation>().x = rot.x;
           sFocusedEntity.getComponent<Rotation>().y = rot.y;
           sFocusedEntity.getComponent<Rotation>().z = rot.z;
+          isTransformChanged = true;
+        }
+
+        if (isTransformChanged) {
+          mTransformHierarchy->markDirty(sFocusedEntity.getId());
         }
 
         // Primitive
@@ -710,9 +719,10 @@ void DebugRenderPipeline::onImGuiRender() {
                                       ImGuiTreeNodeFlags_DefaultOpen)) {
             auto avail = ImGui::GetContentRegionAvail();
 
-            for (uint8_t i = 0; i < p.materialRef.textureCount; i++) {
-              cbz::imgui::Image(p.materialRef.textures[i].imgh,
-                                {avail.x, avail.x});
+            const Material material =
+                mStaticMeshRenderer->getMaterial(p.material);
+            for (uint8_t i = 0; i < material.textureCount; i++) {
+              cbz::imgui::Image(material.textures[i].imgh, {avail.x, avail.x});
             }
           }
         }
@@ -722,15 +732,23 @@ void DebugRenderPipeline::onImGuiRender() {
           if (ImGui::CollapsingHeader("Camera", nullptr,
                                       ImGuiTreeNodeFlags_DefaultOpen)) {
             Camera &camera = sFocusedEntity.getComponent<Camera>();
-            ImGui::DragFloat("Aspect ratio", &camera.aspectRatio);
-            ImGui::DragFloat("Near", &camera.near);
-            ImGui::DragFloat("Far", &camera.far);
+            bool isCameraChanged = false;
+            isCameraChanged |=
+                ImGui::DragFloat("Aspect ratio", &camera.aspectRatio);
+            isCameraChanged |= ImGui::DragFloat("Near", &camera.near);
+            isCameraChanged |= ImGui::DragFloat("Far", &camera.far);
 
             const char *cameraTypeNames[] = {"Perspective", "Orthographic"};
             int currentType = static_cast<int>(camera.type);
             if (ImGui::Combo("Camera Type", &currentType, cameraTypeNames,
                              CAMERA_TYPE_COUNT)) {
               camera.type = static_cast<CameraType>(currentType);
+              isCameraChanged = true;
+            }
+
+            if (isCameraChanged) {
+              rts::SystemSchedulerMarkChanged<Camera>(mScheduler,
+                                                      sFocusedEntity.getId());
             }
           }
         }
@@ -747,6 +765,8 @@ void DebugRenderPipeline::onImGuiRender() {
             if (ImGui::Combo("Type", &currentType, cameraTypeNames,
                              LIGHT_TYPE_COUNT)) {
               lightSource.type = static_cast<LightType>(currentType);
+              rts::SystemSchedulerMarkChanged<LightSource>(
+                  mScheduler, sFocusedEntity.getId());
             }
 
             ImGui::Text("Direction: %.2f %.2f %.2f",
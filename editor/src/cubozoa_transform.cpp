@@ -0,0 +1,306 @@
+#include "cubozoa_transform.h"
+
+#include <rts/rts_job.h>
+#include <rts/rts_query.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Dirty nodes per chunk handed to a worker
+static constexpr uint32_t sTransformGrainSize = 512;
+
+// @brief Writes parent * T * R * S to 'out' without building the three
+// matrices. 'parent' is null for roots.
+static void WorldMatrixCompose(const glm::mat4 *parent, const Position &pos,
+                               const Rotation &rot, const Scale &scale,
+                               glm::mat4 *out) {
+  const float xx = rot.x * rot.x;
+  const float yy = rot.y * rot.y;
+  const float zz = rot.z * rot.z;
+  const float xy = rot.x * rot.y;
+  const float xz = rot.x * rot.z;
+  const float yz = rot.y * rot.z;
+  const float wx = rot.w * rot.x;
+  const float wy = rot.w * rot.y;
+  const float wz = rot.w * rot.z;
+
+  // Columns of the local matrix. The last row is (0, 0, 0, 1).
+  const float local[4][3] = {
+      {(1.0f - 2.0f * (yy + zz)) * scale.x, 2.0f * (xy + wz) * scale.x,
+       2.0f * (xz - wy) * scale.x},
+      {2.0f * (xy - wz) * scale.y, (1.0f - 2.0f * (xx + zz)) * scale.y,
+       2.0f * (yz + wx) * scale.y},
+      {2.0f * (xz + wy) * scale.z, 2.0f * (yz - wx) * scale.z,
+       (1.0f - 2.0f * (xx + yy)) * scale.z},
+      {pos.x, pos.y, pos.z},
+  };
+
+  glm::mat4 &m = *out;
+  if (!parent) {
+    for (int c = 0; c < 4; c++) {
+      m[c] = glm::vec4(local[c][0], local[c][1], local[c][2],
+                       c == 3 ? 1.0f : 0.0f);
+    }
+    return;
+  }
+
+#if defined(__SSE2__)
+  const __m128 p0 = _mm_loadu_ps(&(*parent)[0][0]);
+  const __m128 p1 = _mm_loadu_ps(&(*parent)[1][0]);
+  const __m128 p2 = _mm_loadu_ps(&(*parent)[2][0]);
+  const __m128 p3 = _mm_loadu_ps(&(*parent)[3][0]);
+
+  for (int c = 0; c < 4; c++) {
+    __m128 column = _mm_mul_ps(p0, _mm_set1_ps(local[c][0]));
+    column = _mm_add_ps(column, _mm_mul_ps(p1, _mm_set1_ps(local[c][1])));
+    column = _mm_add_ps(column, _mm_mul_ps(p2, _mm_set1_ps(local[c][2])));
+    if (c == 3) {
+      column = _mm_add_ps(column, p3);
+    }
+    _mm_storeu_ps(&m[c][0], column);
+  }
+#else
+  const glm::mat4 &p = *parent;
+  for (int c = 0; c < 4; c++) {
+    m[c] = p[0] * local[c][0] + p[1] * local[c][1] + p[2] * local[c][2];
+    if (c == 3) {
+      m[c] = m[c] + p[3];
+    }
+  }
+#endif
+}
+
+TransformHierarchy::TransformHierarchy(cbz::ecs::IWorld *world,
+                                       rts::JobSystem *jobs)
+    : mWorld(world), mJobs(jobs), mFirstDirtyNode(0), mIsStructureDirty(true),
+      mStructureVersion(QUERY_CACHE_VERSION_NONE) {}
+
+TransformHierarchy::~TransformHierarchy() = default;
+
+void TransformHierarchy::markDirty(cbz::ecs::EntityId eId) {
+  auto it = mNodeLookup.find(eId);
+  if (it == mNodeLookup.end()) {
+    // New nodes are dirty once added
+    return;
+  }
+
+  mIsDirty[it->second] = 1;
+  mFirstDirtyNode = std::min(mFirstDirtyNode, it->second);
+}
+
+void TransformHierarchy::markStructureDirty() { mIsStructureDirty = true; }
+
+void TransformHierarchy::rebuild() {
+  struct NodeInfo {
+    cbz::ecs::EntityId eId;
+    cbz::ecs::EntityId parentId;
+    bool hasParent;
+    bool isMatrixOnly;
+    uint32_t depth;
+  };
+
+  std::vector<NodeInfo> infos;
+  std::unordered_map<cbz::ecs::EntityId, uint32_t> infoLookup;
+  const auto addInfo = [&](cbz::ecs::EntityId eId, const Transform &t,
+                           bool isMatrixOnly) {
+    const bool hasParent = static_cast<bool>(t.getParent());
+    infoLookup[eId] = static_cast<uint32_t>(infos.size());
+    infos.push_back({eId, hasParent ? t.getParent().getId() : 0, hasParent,
+                     isMatrixOnly, static_cast<uint32_t>(t.getDepth())});
+  };
+
+  mWorld->query<cbz::ecs::Entity, Position, Rotation, Scale, Transform>(
+      [&](cbz::ecs::Entity e, Position &, Rotation &, Scale &, Transform &t) {
+        addInfo(e.getId(), t, false);
+      });
+
+  // Parents without a Position, Rotation and Scale join as matrix only nodes
+  // that follow their 'Transform'. Appended infos are visited too, so whole
+  // chains of them resolve.
+  for (uint32_t infoIdx = 0; infoIdx < infos.size(); infoIdx++) {
+    const NodeInfo info = infos[infoIdx];
+    if (!info.hasParent || infoLookup.count(info.parentId) > 0) {
+      continue;
+    }
+
+    cbz::ecs::Entity parent(info.parentId, mWorld);
+    if (!parent.hasComponent<Transform>()) {
+      spdlog::warn("Parent {} of {} has no Transform. Treated as a root.",
+                   info.parentId, info.eId);
+      infos[infoIdx].hasParent = false;
+      continue;
+    }
+
+    addInfo(info.parentId, parent.getComponent<Transform>(), true);
+  }
+
+  // Counting sort by depth
+  std::vector<uint32_t> levelStarts;
+  for (const NodeInfo &info : infos) {
+    if (levelStarts.size() < info.depth + 2) {
+      levelStarts.resize(info.depth + 2, 0);
+    }
+    levelStarts[info.depth + 1]++;
+  }
+
+  for (uint32_t level = 1; level < levelStarts.size(); level++) {
+    levelStarts[level] += levelStarts[level - 1];
+  }
+
+  std::vector<uint32_t> offsets(levelStarts);
+  std::vector<cbz::ecs::EntityId> entities(infos.size());
+  std::vector<uint8_t> isMatrixOnly(infos.size(), 0);
+  std::vector<uint32_t> matrixOnlyNodes;
+  std::unordered_map<cbz::ecs::EntityId, uint32_t> nodeLookup;
+  nodeLookup.reserve(infos.size());
+  for (const NodeInfo &info : infos) {
+    const uint32_t nodeIdx = offsets[info.depth]++;
+    entities[nodeIdx] = info.eId;
+    nodeLookup[info.eId] = nodeIdx;
+
+    if (info.isMatrixOnly) {
+      isMatrixOnly[nodeIdx] = 1;
+      matrixOnlyNodes.push_back(nodeIdx);
+    }
+  }
+
+  std::vector<uint32_t> parents(infos.size(), kNoParent);
+  for (const NodeInfo &info : infos) {
+    if (info.hasParent) {
+      parents[nodeLookup[info.eId]] = nodeLookup[info.parentId];
+    }
+  }
+
+  // Keep matrices of nodes that still have the same parent
+  std::vector<glm::mat4> worldMatrices(infos.size(), glm::mat4(1.0f));
+  std::vector<uint8_t> isDirty(infos.size(), 1);
+  for (uint32_t nodeIdx = 0; nodeIdx < entities.size(); nodeIdx++) {
+    auto it = mNodeLookup.find(entities[nodeIdx]);
+    if (it == mNodeLookup.end()) {
+      continue;
+    }
+
+    const uint32_t oldIdx = it->second;
+    const uint32_t oldParent = mParents[oldIdx];
+    const uint32_t parent = parents[nodeIdx];
+    const bool isSameParent =
+        oldParent == kNoParent
+            ? parent == kNoParent
+            : parent != kNoParent && mEntities[oldParent] == entities[parent];
+
+    if (isSameParent) {
+      worldMatrices[nodeIdx] = mWorldMatrices[oldIdx];
+      isDirty[nodeIdx] = mIsDirty[oldIdx];
+    }
+  }
+
+  mEntities = std::move(entities);
+  mParents = std::move(parents);
+  mLevelStarts = std::move(levelStarts);
+  mWorldMatrices = std::move(worldMatrices);
+  mIsDirty = std::move(isDirty);
+  mNodeLookup = std::move(nodeLookup);
+  mIsMatrixOnly = std::move(isMatrixOnly);
+  mMatrixOnlyNodes = std::move(matrixOnlyNodes);
+
+  mFirstDirtyNode = 0;
+  mIsStructureDirty = false;
+  mStructureVersion = rts::QueryStructureVersion(mWorld);
+}
+
+void TransformHierarchy::computeNodes(uint32_t begin, uint32_t end) {
+  for (uint32_t i = begin; i < end; i++) {
+    const uint32_t nodeIdx = mDirtyNodes[i];
+    const uint32_t parent = mParents[nodeIdx];
+    const NodeComponents &components = mDirtyComponents[i];
+
+    WorldMatrixCompose(parent == kNoParent ? nullptr : &mWorldMatrices[parent],
+                       *components.pos, *components.rot, *components.scale,
+                       &mWorldMatrices[nodeIdx]);
+    components.transform->set(mWorldMatrices[nodeIdx]);
+  }
+}
+
+void TransformHierarchy::refresh() {
+  if (mIsStructureDirty ||
+      mStructureVersion != rts::QueryStructureVersion(mWorld)) {
+    rebuild();
+  }
+}
+
+void TransformHierarchy::update() {
+  mDirtyNodes.clear();
+  mDirtyComponents.clear();
+  mDirtyLevelStarts.clear();
+
+  // Matrix only nodes are never written, so compare to see if their children
+  // need to follow
+  for (uint32_t nodeIdx : mMatrixOnlyNodes) {
+    const glm::mat4 matrix =
+        cbz::ecs::Entity(mEntities[nodeIdx], mWorld).getComponent<Transform>()
+            .get();
+    if (matrix != mWorldMatrices[nodeIdx]) {
+      mWorldMatrices[nodeIdx] = matrix;
+      mIsDirty[nodeIdx] = 1;
+      mFirstDirtyNode = std::min(mFirstDirtyNode, nodeIdx);
+    }
+  }
+
+  const uint32_t nodeCount = getNodeCount();
+  if (mFirstDirtyNode >= nodeCount) {
+    return;
+  }
+
+  // Parents come first so dirty flags propagate down in one pass. Components
+  // are fetched here so workers never touch the world.
+  for (uint32_t level = 0; level + 1 < mLevelStarts.size(); level++) {
+    mDirtyLevelStarts.push_back(static_cast<uint32_t>(mDirtyNodes.size()));
+
+    const uint32_t levelEnd = mLevelStarts[level + 1];
+    for (uint32_t nodeIdx = std::max(mLevelStarts[level], mFirstDirtyNode);
+         nodeIdx < levelEnd; nodeIdx++) {
+      const uint32_t parent = mParents[nodeIdx];
+      if (!mIsDirty[nodeIdx] && (parent == kNoParent || !mIsDirty[parent])) {
+        continue;
+      }
+      mIsDirty[nodeIdx] = 1;
+
+      // Already follows its 'Transform'
+      if (mIsMatrixOnly[nodeIdx]) {
+        continue;
+      }
+
+      cbz::ecs::Entity e(mEntities[nodeIdx], mWorld);
+      mDirtyNodes.push_back(nodeIdx);
+      mDirtyComponents.push_back(
+          {&e.getComponent<Position>(), &e.getComponent<Rotation>(),
+           &e.getComponent<Scale>(), &e.getComponent<Transform>()});
+    }
+  }
+  mDirtyLevelStarts.push_back(static_cast<uint32_t>(mDirtyNodes.size()));
+
+  // Levels run in order. Nodes within a level are independent.
+  for (uint32_t level = 0; level + 1 < mDirtyLevelStarts.size(); level++) {
+    const uint32_t begin = mDirtyLevelStarts[level];
+    const uint32_t count = mDirtyLevelStarts[level + 1] - begin;
+
+    if (count < 2 * sTransformGrainSize) {
+      computeNodes(begin, begin + count);
+      continue;
+    }
+
+    rts::JobSystemParallelFor(
+        mJobs, count, sTransformGrainSize,
+        [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+          computeNodes(begin + chunkBegin, begin + chunkEnd);
+        });
+  }
+
+  std::fill(mIsDirty.begin() + mFirstDirtyNode, mIsDirty.end(), 0);
+  mFirstDirtyNode = nodeCount;
+}
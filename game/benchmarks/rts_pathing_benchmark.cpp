@@ -0,0 +1,337 @@
+// Benchmarks the RTS pathing kernels over generated maps.
+//
+// Usage: rts_pathing_benchmark [--iterations <n>] [--json <path | ->]
+
+#include <rts/rts.h>
+#include <rts/rts_cost_field.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// --- Allocation tracking ---
+// @note Replacing the global operator new also covers allocations made inside
+// the game library on ELF platforms. Windows DLLs keep their own allocator so
+// peak memory reads 0 there. Counters are atomic so allocations from any
+// thread are counted.
+static std::atomic<size_t> sAllocatedBytes = 0;
+static std::atomic<size_t> sPeakAllocatedBytes = 0;
+
+// Keeps the returned pointer max aligned
+static constexpr size_t sAllocationHeaderSize = alignof(std::max_align_t);
+
+void *operator new(size_t size) {
+  void *ptr = std::malloc(size + sAllocationHeaderSize);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+
+  *static_cast<size_t *>(ptr) = size;
+  const size_t allocatedBytes = sAllocatedBytes += size;
+  size_t peakBytes = sPeakAllocatedBytes.load();
+  while (peakBytes < allocatedBytes &&
+         !sPeakAllocatedBytes.compare_exchange_weak(peakBytes,
+                                                    allocatedBytes)) {
+  }
+
+  return static_cast<uint8_t *>(ptr) + sAllocationHeaderSize;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept {
+  if (!ptr) {
+    return;
+  }
+
+  void *header = static_cast<uint8_t *>(ptr) - sAllocationHeaderSize;
+  sAllocatedBytes -= *static_cast<size_t *>(header);
+  std::free(header);
+}
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+
+// --- Maps ---
+typedef enum : uint32_t {
+  MAP_TYPE_OPEN = 0,
+  MAP_TYPE_MAZE,
+  MAP_TYPE_TERRAIN,
+  MAP_TYPE_COUNT,
+} MapType;
+
+static const char *sMapTypeNames[MAP_TYPE_COUNT] = {"open", "maze", "terrain"};
+
+// Playable region sizes. Cells outside the region are impassable.
+static constexpr int sRegionSizes[] = {64, 128, 256};
+
+struct BenchmarkMap {
+  MapType type;
+  int size;
+
+  rts::CostField costField;
+  rts::IVec2 start;
+  rts::IVec2 goal;
+};
+
+static void MazeCarve(rts::CostField *field, int size, std::mt19937 &rng) {
+  // Rooms on odd cells, walls in between
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      rts::CostFieldSetTerrain(field, {x, y}, CELL_TYPE_NONE);
+    }
+  }
+
+  const int roomCount = (size - 1) / 2;
+  std::vector<bool> visited(roomCount * roomCount, false);
+  std::vector<rts::IVec2> stack = {{0, 0}};
+  visited[0] = true;
+  rts::CostFieldSetTerrain(field, {1, 1}, CELL_TYPE_GROUND);
+
+  constexpr int directions[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+  while (!stack.empty()) {
+    rts::IVec2 room = stack.back();
+
+    int candidates[4];
+    int candidateCount = 0;
+    for (int i = 0; i < 4; i++) {
+      int nx = room.x + directions[i][0];
+      int ny = room.y + directions[i][1];
+      if (nx >= 0 && nx < roomCount && ny >= 0 && ny < roomCount &&
+          !visited[ny * roomCount + nx]) {
+        candidates[candidateCount++] = i;
+      }
+    }
+
+    if (candidateCount == 0) {
+      stack.pop_back();
+      continue;
+    }
+
+    const int *dir = directions[candidates[rng() % candidateCount]];
+    rts::IVec2 next = {room.x + dir[0], room.y + dir[1]};
+    visited[next.y * roomCount + next.x] = true;
+
+    // Open wall and next room
+    rts::CostFieldSetTerrain(
+        field, {room.x * 2 + 1 + dir[0], room.y * 2 + 1 + dir[1]},
+        CELL_TYPE_GROUND);
+    rts::CostFieldSetTerrain(field, {next.x * 2 + 1, next.y * 2 + 1},
+                             CELL_TYPE_GROUND);
+    stack.push_back(next);
+  }
+}
+
+static void BenchmarkMapCreate(BenchmarkMap *map, MapType type, int size) {
+  std::mt19937 rng(1337);
+
+  map->type = type;
+  map->size = size;
+  rts::CostFieldInit(&map->costField);
+
+  for (int y = 0; y < GRID_Y; y++) {
+    for (int x = 0; x < GRID_X; x++) {
+      if (x >= size || y >= size) {
+        rts::CostFieldSetTerrain(&map->costField, {x, y}, CELL_TYPE_NONE);
+      }
+    }
+  }
+
+  switch (type) {
+  case MAP_TYPE_OPEN:
+    break;
+  case MAP_TYPE_MAZE: {
+    MazeCarve(&map->costField, size, rng);
+  } break;
+  case MAP_TYPE_TERRAIN: {
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        uint32_t roll = rng() % 100;
+        if (roll < 10) {
+          rts::CostFieldSetTerrain(&map->costField, {x, y}, CELL_TYPE_WATER);
+        } else if (roll < 30) {
+          rts::CostFieldSetTerrain(&map->costField, {x, y}, CELL_TYPE_MUD);
+        }
+      }
+    }
+  } break;
+  case MAP_TYPE_COUNT:
+    break;
+  }
+
+  // Odd cells are rooms in the maze
+  map->start = {1, 1};
+  map->goal = {(size / 2) | 1, (size / 2) | 1};
+  rts::CostFieldSetTerrain(&map->costField, map->start, CELL_TYPE_GROUND);
+  rts::CostFieldSetTerrain(&map->costField, map->goal, CELL_TYPE_GROUND);
+}
+
+// --- Results ---
+struct BenchmarkResult {
+  const char *kernel;
+  MapType mapType;
+  int size;
+
+  double medianNs;
+  rts::PathingStats stats;
+  size_t peakBytes;
+};
+
+template <typename Fn>
+static BenchmarkResult BenchmarkRun(const char *kernel, const BenchmarkMap &map,
+                                    uint32_t iterations, Fn &&fn) {
+  BenchmarkResult result = {kernel, map.type, map.size, 0.0, {}, 0};
+  std::vector<double> samples(iterations);
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    const size_t baselineBytes = sAllocatedBytes;
+    sPeakAllocatedBytes = baselineBytes;
+
+    auto start = std::chrono::steady_clock::now();
+    result.stats = fn();
+    auto end = std::chrono::steady_clock::now();
+
+    samples[i] = std::chrono::duration<double, std::nano>(end - start).count();
+    result.peakBytes =
+        std::max(result.peakBytes, sPeakAllocatedBytes.load() - baselineBytes);
+  }
+
+  std::sort(samples.begin(), samples.end());
+  result.medianNs = samples[samples.size() / 2];
+  return result;
+}
+
+static double NsPerCell(const BenchmarkResult &result) {
+  return result.stats.cellsVisited > 0
+             ? result.medianNs / result.stats.cellsVisited
+             : 0.0;
+}
+
+static void ResultsWriteJson(FILE *file,
+                             const std::vector<BenchmarkResult> &results,
+                             uint32_t iterations) {
+  fprintf(file, "{\n");
+  fprintf(file, "  \"benchmark\": \"rts_pathing\",\n");
+  fprintf(file, "  \"grid\": [%d, %d],\n", GRID_X, GRID_Y);
+  fprintf(file, "  \"iterations\": %u,\n", iterations);
+  fprintf(file, "  \"results\": [\n");
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &result = results[i];
+    fprintf(file,
+            "    {\"kernel\": \"%s\", \"map\": \"%s\", \"size\": %d, "
+            "\"median_ns\": %.0f, \"ns_per_cell\": %.3f, "
+            "\"cells_expanded\": %u, \"cells_visited\": %u, "
+            "\"peak_bytes\": %zu}%s\n",
+            result.kernel, sMapTypeNames[result.mapType], result.size,
+            result.medianNs, NsPerCell(result), result.stats.cellsExpanded,
+            result.stats.cellsVisited, result.peakBytes,
+            i + 1 < results.size() ? "," : "");
+  }
+
+  fprintf(file, "  ]\n");
+  fprintf(file, "}\n");
+}
+
+int main(int argc, char **argv) {
+  uint32_t iterations = 20;
+  const char *jsonPath = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      jsonPath = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--iterations <n>] [--json <path | ->]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<BenchmarkResult> results;
+
+  std::vector<int> integrationField(GRID_X * GRID_Y);
+  std::vector<rts::Vec2> flowField(GRID_X * GRID_Y);
+  std::vector<rts::IVec2> waypoints(GRID_X * GRID_Y);
+
+  for (uint32_t mapType = 0; mapType < MAP_TYPE_COUNT; mapType++) {
+    for (int size : sRegionSizes) {
+      std::unique_ptr<BenchmarkMap> map = std::make_unique<BenchmarkMap>();
+      BenchmarkMapCreate(map.get(), static_cast<MapType>(mapType), size);
+
+      std::vector<int> costField = map->costField.costs;
+      costField[map->goal.y * GRID_X + map->goal.x] = 0;
+
+      results.push_back(BenchmarkRun(
+          "integration_field", *map, iterations, [&]() {
+            rts::PathingStats stats = {};
+            rts::IntegrationFieldCreate(costField.data(), map->goal, size,
+                                        integrationField.data(), &stats);
+            return stats;
+          }));
+
+      // Flow fields always process the whole grid
+      results.push_back(BenchmarkRun(
+          "flow_field", *map, iterations, [&]() {
+            rts::FlowFieldCreate(integrationField.data(), map->goal, size,
+                                 flowField.data());
+            return rts::PathingStats{GRID_X * GRID_Y, GRID_X * GRID_Y};
+          }));
+
+      results.push_back(BenchmarkRun(
+          "astar", *map, iterations, [&]() {
+            rts::PathingStats stats = {};
+            uint32_t waypointCount = rts::PathCreate(
+                map->costField.costs.data(), map->start, map->goal,
+                waypoints.data(), static_cast<uint32_t>(waypoints.size()),
+                &stats);
+            if (waypointCount == 0) {
+              fprintf(stderr, "astar: no path on %s %d\n",
+                      sMapTypeNames[map->type], map->size);
+            }
+            return stats;
+          }));
+    }
+  }
+
+  // Keep stdout clean when it carries the JSON
+  FILE *tableFile =
+      jsonPath && strcmp(jsonPath, "-") == 0 ? stderr : stdout;
+
+  fprintf(tableFile, "%-18s %-8s %5s %12s %10s %10s %10s %12s\n", "kernel",
+          "map", "size", "median(us)", "ns/cell", "expanded", "visited",
+          "peak(KiB)");
+  for (const BenchmarkResult &result : results) {
+    fprintf(tableFile, "%-18s %-8s %5d %12.1f %10.3f %10u %10u %12.1f\n",
+            result.kernel, sMapTypeNames[result.mapType], result.size,
+            result.medianNs / 1000.0, NsPerCell(result),
+            result.stats.cellsExpanded, result.stats.cellsVisited,
+            result.peakBytes / 1024.0);
+  }
+
+  if (jsonPath) {
+    FILE *file = strcmp(jsonPath, "-") == 0 ? stdout : fopen(jsonPath, "w");
+    if (!file) {
+      fprintf(stderr, "Failed to open %s\n", jsonPath);
+      return 1;
+    }
+
+    ResultsWriteJson(file, results, iterations);
+    if (file != stdout) {
+      fclose(file);
+    }
+  }
+
+  return 0;
+}
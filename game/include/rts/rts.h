@@ -38,9 +38,37 @@ struct CBZ_API Unit {
   real_t movement_speed;
 };
 
+typedef enum : uint32_t {
+  UNIT_MOVE_TYPE_NONE = 0,
+  UNIT_MOVE_TYPE_PATH,
+  UNIT_MOVE_TYPE_FLOW_FIELD,
+
+  // Straight to 'targetDst' on the final approach to a formation slot
+  UNIT_MOVE_TYPE_SLOT,
+} UnitMoveType;
+
 struct CBZ_API UnitMoveState {
   float targetDst[3];
   CBZBool32 isMoving;
+
+  // 'targetDst' is a formation slot rather than the order destination
+  CBZBool32 hasSlot;
+
+  UnitMoveType moveType;
+  uint32_t orderIdx;    // Index of the path or flow field being followed
+  uint32_t waypointIdx; // Next waypoint when following a path
+};
+
+// @brief Units are pooled. Despawned units keep their components until they
+// are respawned. Systems skip units that are not alive.
+struct CBZ_API UnitPoolState {
+  CBZBool32 isAlive;
+};
+
+#define TEAM_COUNT 8
+
+struct CBZ_API UnitTeam {
+  uint32_t idx;
 };
 
 struct CBZ_API UnitAssetId {
@@ -53,6 +81,8 @@ namespace rts {
 
 typedef uint32_t unitId;
 
+#define UNIT_ID_INVALID UINT32_MAX
+
 struct CBZ_API CellPosition {
   uint8_t x;
   uint8_t y;
@@ -62,15 +92,17 @@ struct CBZ_API CellPosition {
 #define GRID_X 256
 #define GRID_Y 256
 
-// --- Simulation Functions ---
-CBZ_API void Init();
-CBZ_API void Step();
-CBZ_API void Shutdown();
+// Grid cells per sector (per axis)
+#define SECTOR_SIZE 16
+#define SECTOR_X (GRID_X / SECTOR_SIZE)
+#define SECTOR_Y (GRID_Y / SECTOR_SIZE)
 
-// --- Unit Functions ---
-CBZ_API CBZ_NO_DISCARD unitId Spawn(UnitAssetId unitAssetId, Position dst);
-CBZ_API void MoveTo(unitId unit, Position dst);
-CBZ_API void Attack(unitId attacker, unitId target);
+// Cost field values at or above are not traversable
+#define COST_IMPASSABLE 255
+
+// Octile step weights scaling cell costs in integration fields and paths
+#define STEP_COST_STRAIGHT 10
+#define STEP_COST_DIAGONAL 14
 
 struct CBZ_API Vec2 {
   float x;
@@ -82,12 +114,111 @@ struct CBZ_API IVec2 {
   int y;
 };
 
+// --- Simulation Functions ---
+// Seconds simulated by each 'Step'
+#define STEP_DELTA_TIME (1.0f / 30.0f)
+
+struct JobSystem;
+
+// @param jobs runs the simulation systems. See rts_job.h.
+CBZ_API void Init(JobSystem *jobs);
+
+// @brief Advances the simulation by 'STEP_DELTA_TIME'. Call at a fixed rate.
+CBZ_API void Step();
+CBZ_API void Shutdown();
+
+// --- Unit Functions ---
+// @brief Spawns a unit with the stats of archetype 'unitAssetId' in the unit
+// table (see rts_unit_table.h).
+CBZ_API CBZ_NO_DISCARD unitId Spawn(UnitAssetId unitAssetId, Position dst);
+
+// @brief Spawns 'count' units of the same archetype, one at each of 'dsts'.
+// @note Reuses despawned units and grows the pool in batches when empty.
+CBZ_API void SpawnBulk(UnitAssetId unitAssetId, const Position *dsts,
+                       uint32_t count, unitId *outUnits);
+
+// @brief Returns 'unit' to the pool. Units die and despawn when their health
+// drops to 0.
+CBZ_API void Despawn(unitId unit);
+
+CBZ_API CBZ_NO_DISCARD bool IsAlive(unitId unit);
+
+// @brief Units spawn on team 0.
+CBZ_API void SetTeam(unitId unit, uint32_t team);
+CBZ_API CBZ_NO_DISCARD uint32_t GetTeam(unitId unit);
+
+// @returns the archetype 'unit' was last spawned as, e.g. to look up its
+// script. 'UNIT_ASSET_ID_INVALID' if unknown.
+CBZ_API CBZ_NO_DISCARD UnitAssetId GetUnitAssetId(unitId unit);
+
+// @brief Pre-creates pooled units so spawning up to 'count' units allocates
+// no entities.
+CBZ_API void ReserveUnits(uint32_t count);
+
+CBZ_API void MoveTo(unitId unit, Position dst);
+CBZ_API void Attack(unitId attacker, unitId target);
+
+typedef enum : uint32_t {
+  // All units move to the destination
+  FORMATION_TYPE_NONE = 0,
+  FORMATION_TYPE_LINE,
+  FORMATION_TYPE_BOX,
+  FORMATION_TYPE_WEDGE,
+  FORMATION_TYPE_COUNT,
+} FormationType;
+
+// @brief Issues a single move order for a group of units.
+// @note Small groups travelling short distances path individually with A*.
+// Larger orders share a single flow field to the destination. With a
+// formation, each unit is given a slot around 'dst' facing the direction of
+// travel and leaves the shared route to steer straight to it once close.
+CBZ_API void MoveGroupTo(const unitId *units, uint32_t count, Position dst,
+                         FormationType formation = FORMATION_TYPE_NONE);
+
+// --- Grid ---
+// @note World origin maps to the center of the grid. World 'z' maps to grid
+// 'y'.
+CBZ_API CBZ_NO_DISCARD IVec2 WorldToCell(Position position);
+CBZ_API CBZ_NO_DISCARD Position CellToWorld(IVec2 cell);
+
 // --- Util ---
+// @brief Adds 'weights[i] * weightScale' bilinearly to the 4 cells of a
+// coarse grid around each position. Weights are 1 if 'weights' is null.
+// @param positionsX fine grid cell space
+// @param cellSize fine grid cells per coarse cell (per axis). Weight falling
+// past the edges lands on the border cells.
+CBZ_API void CoarseGridSplat(float *grid, int gridX, int gridY, int cellSize,
+                             const float *positionsX, const float *positionsY,
+                             const float *weights, float weightScale,
+                             uint32_t count);
+
+struct CBZ_API PathingStats {
+  // Cells popped from the open list, including reopened cells
+  uint32_t cellsExpanded;
+
+  // Cells read while searching. Jumps visit many cells per expansion.
+  uint32_t cellsVisited;
+};
+
+// @brief Points each cell at its cheapest neighbor in 'integrationField'.
+// Diagonals are skipped when they would cut a wall corner.
 CBZ_API void FlowFieldCreate(const int *integrationField, IVec2 center,
                              int searchRadius, Vec2 *out);
 
+// @brief Dijkstra from 'center' over the 8 neighbors of each cell. Entering a
+// cell costs its cost field value times 'STEP_COST_STRAIGHT' or
+// 'STEP_COST_DIAGONAL'. Diagonals never cut wall corners. Unreachable cells
+// are 'INT_MAX'.
 CBZ_API void IntegrationFieldCreate(const int *costField, IVec2 center,
-                                    int searchRadius, int *integrationField);
+                                    int searchRadius, int *integrationField,
+                                    PathingStats *stats = nullptr);
+
+// @brief Grid A* with jump point pruning inside uniform cost regions.
+// @returns the number of waypoints written to 'outPath' excluding 'start'.
+// 0 if 'goal' is unreachable or the path needs more than 'maxWaypoints'.
+CBZ_API uint32_t PathCreate(const int *costField, IVec2 start, IVec2 goal,
+                            IVec2 *outPath, uint32_t maxWaypoints,
+                            PathingStats *stats = nullptr);
 
 }; // namespace rts
 
@@ -0,0 +1,93 @@
+#ifndef RTS_ARENA_H_
+#define RTS_ARENA_H_
+
+#include "rts/rts.h"
+#include "rts/rts_job.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace rts {
+
+// Sub-arenas, one per job system thread
+#define FRAME_ARENA_MAX_THREADS JOB_MAX_THREADS
+
+// Default bytes reserved per thread
+#define FRAME_ARENA_DEFAULT_CAPACITY (1 << 20)
+
+// @brief Bump allocator over one block. Allocations that do not fit get their
+// own block until the next reset, which grows the main block to fit them.
+struct CBZ_API LinearArena {
+  uint8_t *block;
+  size_t capacity;
+  size_t offset;
+
+  std::vector<void *> overflowBlocks;
+  size_t overflowBytes;
+};
+
+// @brief Scratch memory that lives until the end of the frame. Each thread
+// bumps its own sub-arena so allocating needs no locks.
+// @note Memory is never freed individually. Everything is released at once by
+// 'FrameArenaReset', which must not run while other threads allocate.
+struct CBZ_API FrameArena {
+  LinearArena threadArenas[FRAME_ARENA_MAX_THREADS];
+  size_t threadCapacity;
+};
+
+// @param threadCapacity bytes reserved by each thread on first use
+CBZ_API void
+FrameArenaInit(FrameArena *arena,
+               size_t threadCapacity = FRAME_ARENA_DEFAULT_CAPACITY);
+CBZ_API void FrameArenaShutdown(FrameArena *arena);
+
+// @brief Releases every allocation. Call once per frame, e.g. after
+// 'cbz::Frame()'.
+CBZ_API void FrameArenaReset(FrameArena *arena);
+
+// @returns 'size' bytes aligned to 'alignment' from the calling thread's
+// sub-arena.
+CBZ_API CBZ_NO_DISCARD void *FrameArenaAlloc(FrameArena *arena, size_t size,
+                                             size_t alignment);
+
+// @returns sub-arena index of the calling thread, its job system thread index.
+// @note Only job system threads may allocate. Other threads abort.
+CBZ_API CBZ_NO_DISCARD uint32_t FrameArenaThreadIndex();
+
+template <typename T>
+CBZ_NO_DISCARD T *FrameArenaAllocArray(FrameArena *arena, size_t count) {
+  return static_cast<T *>(
+      FrameArenaAlloc(arena, sizeof(T) * count, alignof(T)));
+}
+
+// @brief Allocator for standard containers backed by a frame arena.
+// Deallocation does nothing, so reserve up front to avoid wasting growth.
+template <typename T> struct FrameAllocator {
+  using value_type = T;
+
+  FrameArena *arena;
+
+  explicit FrameAllocator(FrameArena *arena) : arena(arena) {}
+
+  template <typename U>
+  FrameAllocator(const FrameAllocator<U> &other) : arena(other.arena) {}
+
+  T *allocate(size_t count) { return FrameArenaAllocArray<T>(arena, count); }
+  void deallocate(T *, size_t) {}
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T> &a, const FrameAllocator<U> &b) {
+  return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T> &a, const FrameAllocator<U> &b) {
+  return a.arena != b.arena;
+}
+
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+}; // namespace rts
+
+#endif // RTS_ARENA_H_
@@ -0,0 +1,124 @@
+#ifndef RTS_BEHAVIOR_H_
+#define RTS_BEHAVIOR_H_
+
+#include "rts/rts.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace rts {
+
+typedef enum : uint32_t {
+  BEHAVIOR_STATUS_SUCCESS = 0,
+  BEHAVIOR_STATUS_FAILURE,
+  BEHAVIOR_STATUS_RUNNING,
+} BehaviorStatus;
+
+typedef enum : uint32_t {
+  // Ticks children in order while they succeed
+  BEHAVIOR_NODE_TYPE_SEQUENCE = 0,
+
+  // Ticks children in order until one does not fail
+  BEHAVIOR_NODE_TYPE_SELECTOR,
+
+  // Ticks the child with the highest score
+  BEHAVIOR_NODE_TYPE_UTILITY,
+
+  // Condition or action
+  BEHAVIOR_NODE_TYPE_LEAF,
+  BEHAVIOR_NODE_TYPE_COUNT,
+} BehaviorNodeType;
+
+struct BehaviorGroup;
+
+// @brief Ticks a leaf for a batch of agents.
+// @param statuses indexed by agent, not by position in 'agentIdxs'
+typedef void (*BehaviorLeafFn)(BehaviorGroup *group, const uint32_t *agentIdxs,
+                               uint32_t count, BehaviorStatus *statuses);
+
+// @brief Scores a utility child for a batch of agents.
+// @param outScores indexed by position in 'agentIdxs'
+typedef void (*BehaviorScoreFn)(BehaviorGroup *group,
+                                const uint32_t *agentIdxs, uint32_t count,
+                                float *outScores);
+
+struct CBZ_API BehaviorNode {
+  BehaviorNodeType type;
+
+  // Nodes in this subtree including itself. The next sibling is at
+  // 'nodeIdx + subtreeSize'.
+  uint32_t subtreeSize;
+
+  BehaviorLeafFn leaf;
+
+  // Score when the parent is a utility node. Scores 0 if null.
+  BehaviorScoreFn score;
+};
+
+// @brief Behavior tree flattened in pre order.
+struct CBZ_API BehaviorTree {
+  std::vector<BehaviorNode> nodes;
+  uint32_t maxDepth;
+
+  // Composites still open while building
+  std::vector<uint32_t> openNodes;
+};
+
+// --- Building ---
+CBZ_API void BehaviorTreeInit(BehaviorTree *tree);
+
+// @brief Opens a composite. Nodes added until the matching
+// 'BehaviorTreeEnd' are its children.
+CBZ_API void BehaviorTreeBegin(BehaviorTree *tree, BehaviorNodeType type,
+                               BehaviorScoreFn score = nullptr);
+CBZ_API void BehaviorTreeEnd(BehaviorTree *tree);
+
+CBZ_API void BehaviorTreeLeaf(BehaviorTree *tree, BehaviorLeafFn leaf,
+                              BehaviorScoreFn score = nullptr);
+
+// --- Groups ---
+// @brief Agents sharing a tree, ticked together in batches.
+// @note Blackboards are SoA: one column per key, indexed by agent. Agents are
+// swap removed so indices are only stable until the next removal.
+struct CBZ_API BehaviorGroup {
+  const BehaviorTree *tree;
+
+  // Each agent is ticked every 'tickInterval' steps, staggered round robin
+  uint32_t tickInterval;
+
+  std::vector<unitId> units;
+  std::unordered_map<unitId, uint32_t> agentLookup;
+
+  std::vector<std::vector<float>> floatKeys;
+  std::vector<std::vector<int32_t>> intKeys;
+
+  // Status of the last node ticked per agent. The root status after a tick.
+  std::vector<BehaviorStatus> statuses;
+
+  void *userData;
+
+  // Tick scratch
+  std::vector<uint32_t> scratch;
+  std::vector<float> scoreScratch;
+};
+
+CBZ_API void BehaviorGroupInit(BehaviorGroup *group, const BehaviorTree *tree,
+                               uint32_t floatKeyCount, uint32_t intKeyCount,
+                               uint32_t tickInterval = 1);
+
+// @returns the agent index of 'unit'. Blackboard values start at 0.
+CBZ_API uint32_t BehaviorGroupAdd(BehaviorGroup *group, unitId unit);
+CBZ_API void BehaviorGroupRemove(BehaviorGroup *group, unitId unit);
+
+// @brief Ticks the agents due on step 'stepIdx' through the tree together.
+// Every node is visited once per tick with all agents that reached it.
+// @note Leaves must not add or remove agents.
+CBZ_API void BehaviorGroupTick(BehaviorGroup *group, uint64_t stepIdx);
+
+// @brief Ticks 'group' every simulation step. Despawned units are removed.
+CBZ_API void RegisterBehaviorGroup(BehaviorGroup *group);
+CBZ_API void UnregisterBehaviorGroup(BehaviorGroup *group);
+
+}; // namespace rts
+
+#endif // RTS_BEHAVIOR_H_
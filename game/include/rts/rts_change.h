@@ -0,0 +1,92 @@
+#ifndef RTS_CHANGE_H_
+#define RTS_CHANGE_H_
+
+#include "rts/rts.h"
+#include "rts/rts_query.h"
+
+#include <initializer_list>
+#include <vector>
+
+namespace rts {
+
+// Entities per change block. Blocks let unchanged ranges be skipped without
+// reading every entity's tick.
+#define CHANGE_BLOCK_SIZE 64
+
+// @brief Tick of the last write to a component, per entity and per block of
+// entity ids. Entities never marked have tick 0.
+struct CBZ_API ChangeTicks {
+  std::vector<uint64_t> entityTicks;
+  std::vector<uint64_t> blockTicks;
+};
+
+CBZ_API void ChangeTicksMark(ChangeTicks *changes, cbz::ecs::EntityId eId,
+                             uint64_t tick);
+
+// @returns true if any entity of block 'blockIdx' was marked at or after
+// 'tick'.
+CBZ_API CBZ_NO_DISCARD bool
+ChangeTicksBlockChangedSince(const ChangeTicks *changes, uint32_t blockIdx,
+                             uint64_t tick);
+
+// @returns true if 'eId' was marked at or after 'tick'.
+CBZ_API CBZ_NO_DISCARD bool ChangeTicksChangedSince(const ChangeTicks *changes,
+                                                    cbz::ecs::EntityId eId,
+                                                    uint64_t tick);
+
+// @brief Calls 'fn' for each cached entity changed in any of 'changes' at or
+// after 'sinceTick'. Pass a 'sinceTick' of 0 after the cache rebuilt so new
+// entities are visited.
+// @note Consecutive cached entities in the same change block are skipped
+// together when none of 'changes' touched the block since 'sinceTick'.
+template <typename... Ts, typename Fn>
+void QueryCacheForEachChanged(
+    const QueryCache<Ts...> *cache, cbz::ecs::IWorld *world,
+    std::initializer_list<const ChangeTicks *> changes, uint64_t sinceTick,
+    Fn &&fn) {
+  const uint32_t count = QueryCacheCount(cache);
+  for (uint32_t i = 0; i < count; i++) {
+    const cbz::ecs::EntityId eId = cache->entities[i];
+
+    if (sinceTick != 0) {
+      const uint32_t blockIdx =
+          static_cast<uint32_t>(eId / CHANGE_BLOCK_SIZE);
+
+      bool isBlockChanged = false;
+      for (const ChangeTicks *componentChanges : changes) {
+        isBlockChanged =
+            isBlockChanged || ChangeTicksBlockChangedSince(
+                                  componentChanges, blockIdx, sinceTick);
+      }
+
+      if (!isBlockChanged) {
+        // Skip the rest of the block
+        while (i + 1 < count &&
+               cache->entities[i + 1] / CHANGE_BLOCK_SIZE == blockIdx) {
+          i++;
+        }
+        continue;
+      }
+    }
+
+    bool isChanged = sinceTick == 0;
+    for (const ChangeTicks *componentChanges : changes) {
+      isChanged = isChanged ||
+                  ChangeTicksChangedSince(componentChanges, eId, sinceTick);
+    }
+
+    if (!isChanged) {
+      continue;
+    }
+
+    if constexpr (std::is_invocable_v<Fn &, cbz::ecs::Entity, Ts &...>) {
+      fn(cbz::ecs::Entity(eId, world), *QueryCacheComponents<Ts>(cache)[i]...);
+    } else {
+      fn(*QueryCacheComponents<Ts>(cache)[i]...);
+    }
+  }
+}
+
+}; // namespace rts
+
+#endif // RTS_CHANGE_H_
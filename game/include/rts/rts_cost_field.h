@@ -0,0 +1,113 @@
+#ifndef RTS_COST_FIELD_H_
+#define RTS_COST_FIELD_H_
+
+#include "rts/rts.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace rts {
+
+// @brief Grid footprint of an obstacle (building, prop) centered on its
+// 'Position'.
+struct CBZ_API Footprint {
+  uint8_t width = 1;
+  uint8_t height = 1;
+
+  // Cost added to every covered cell
+  int cost = COST_IMPASSABLE;
+};
+
+// @brief Obstacles are pooled like units. Despawned obstacles keep their
+// components and are no longer stamped.
+struct CBZ_API ObstaclePoolState {
+  CBZBool32 isAlive;
+};
+
+typedef uint32_t obstacleId;
+
+// Inclusive cell bounds
+struct CBZ_API CellRect {
+  IVec2 min;
+  IVec2 max;
+};
+
+// @brief Cost field derived from terrain and obstacle footprints.
+// @note Changes restamp only the cells they touch and bump the version of
+// each sector touched, so caches built from the field can invalidate per
+// sector.
+struct CBZ_API CostField {
+  struct ObstacleStamp {
+    CellRect rect;
+    int cost;
+    uint32_t syncGeneration;
+  };
+
+  std::vector<int> costs;
+  std::vector<CellType> terrain;
+
+  // Sum of obstacle costs covering each cell
+  std::vector<int> obstacleCosts;
+
+  // Crowd density cost of each cell. See rts_crowd.h.
+  std::vector<int> densityCosts;
+
+  std::vector<uint32_t> sectorVersions;
+
+  std::unordered_map<uint32_t, ObstacleStamp> obstacles;
+  uint32_t syncGeneration;
+};
+
+CBZ_API CBZ_NO_DISCARD int CellTypeCost(CellType type);
+
+// @brief Resets 'field' to ground terrain with no obstacles.
+CBZ_API void CostFieldInit(CostField *field);
+
+CBZ_API void CostFieldSetTerrain(CostField *field, IVec2 cell, CellType type);
+
+// @brief Sets the terrain of every cell in 'rect', e.g. when loading a level.
+// Touched sectors are bumped once.
+CBZ_API void CostFieldFillTerrain(CostField *field, CellRect rect,
+                                  CellType type);
+
+// @brief Computes the cells covered by 'footprint' centered on 'position'.
+CBZ_API CBZ_NO_DISCARD CellRect FootprintRect(const Footprint &footprint,
+                                              Position position);
+
+// @brief Stamps or moves obstacle 'obstacleId'. Restamps only if its rect or
+// cost changed since the last call. Marks the obstacle as seen this sync.
+CBZ_API void CostFieldStampObstacle(CostField *field, uint32_t obstacleId,
+                                    CellRect rect, int cost);
+
+CBZ_API void CostFieldRemoveObstacle(CostField *field, uint32_t obstacleId);
+
+// @brief Sets the density cost of every cell in 'rect'. Density never makes a
+// passable cell impassable.
+// @note Sector versions are left alone so callers setting many rects can bump
+// each sector once with 'CostFieldTouchSectors'.
+// @returns true if any cell's density cost changed.
+CBZ_API bool CostFieldSetDensity(CostField *field, CellRect rect, int cost);
+
+// @brief Bumps the version of every sector 'rect' overlaps.
+CBZ_API void CostFieldTouchSectors(CostField *field, CellRect rect);
+
+// @brief Starts a sync pass. Obstacles not stamped before the matching
+// 'CostFieldEndSync' are removed.
+CBZ_API void CostFieldBeginSync(CostField *field);
+CBZ_API void CostFieldEndSync(CostField *field);
+
+// @brief Cost field of the simulation. Synced from 'Footprint' components
+// every step.
+CBZ_API CBZ_NO_DISCARD CostField *GetCostField();
+
+// @brief Places an obstacle in the simulation. Its footprint is stamped into
+// the cost field from the next step on.
+CBZ_API CBZ_NO_DISCARD obstacleId SpawnObstacle(Position position,
+                                               Footprint footprint);
+
+// @brief Returns 'obstacle' to the pool. Its cells are freed on the next step.
+CBZ_API void DespawnObstacle(obstacleId obstacle);
+
+}; // namespace rts
+
+#endif // RTS_COST_FIELD_H_
@@ -0,0 +1,57 @@
+#ifndef RTS_CROWD_H_
+#define RTS_CROWD_H_
+
+#include "rts/rts_cost_field.h"
+
+namespace rts {
+
+// Fine grid cells per coarse density cell (per axis)
+#define CROWD_DENSITY_CELL_SIZE 4
+#define CROWD_DENSITY_X (GRID_X / CROWD_DENSITY_CELL_SIZE)
+#define CROWD_DENSITY_Y (GRID_Y / CROWD_DENSITY_CELL_SIZE)
+
+struct CBZ_API CrowdDensitySettings {
+  // Cost added to a cell per unit of density in its coarse cell
+  float costPerUnit = 2.0f;
+
+  // Upper bound on the density cost added to a single cell
+  int maxDensityCost = 16;
+
+  // Minimum density delta in a sector before its costs are restamped
+  float changeThreshold = 0.5f;
+};
+
+// @brief Coarse crowd density layer folded into the simulation's cost field.
+// @note Continuum crowds style: units are splatted bilinearly into a coarse
+// grid every step and the resulting density is added to the costs used for
+// pathing. Only sectors whose density changed beyond the threshold are
+// restamped, and only those whose rounded density costs changed bump their
+// cost field sector version, once per apply.
+struct CBZ_API CrowdDensityField {
+  // Density splatted this step
+  float density[CROWD_DENSITY_X * CROWD_DENSITY_Y];
+
+  // Density last folded into the cost field
+  float appliedDensity[CROWD_DENSITY_X * CROWD_DENSITY_Y];
+};
+
+CBZ_API void CrowdDensityFieldInit(CrowdDensityField *field);
+
+// @brief Clears and splats unit positions (in fine grid cell space) into the
+// density grid, e.g. those of the unit grid.
+CBZ_API void CrowdDensitySplat(CrowdDensityField *field,
+                               const float *positionsX,
+                               const float *positionsY, uint32_t count);
+
+// @brief Folds density into the density costs of 'costField' for all sectors
+// that changed beyond the settings threshold. Untouched sectors keep their
+// previous costs and sector versions.
+// @returns the number of sectors whose costs changed. 0 means flow fields built
+// from 'costField' are still valid.
+CBZ_API uint32_t CrowdDensityApply(CrowdDensityField *field,
+                                   CostField *costField,
+                                   const CrowdDensitySettings &settings = {});
+
+}; // namespace rts
+
+#endif // RTS_CROWD_H_
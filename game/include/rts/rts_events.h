@@ -0,0 +1,90 @@
+#ifndef RTS_EVENTS_H_
+#define RTS_EVENTS_H_
+
+#include "rts/rts.h"
+#include "rts/rts_job.h"
+
+#include <vector>
+
+namespace rts {
+
+// One writer per job system thread. Writer 0 is the main thread.
+#define GAME_EVENT_MAX_WRITERS JOB_MAX_THREADS
+
+typedef enum : uint32_t {
+  GAME_EVENT_TYPE_DAMAGE = 0,
+  GAME_EVENT_TYPE_PROJECTILE_IMPACT,
+  GAME_EVENT_TYPE_STATUS_EXPIRED,
+  GAME_EVENT_TYPE_UNIT_DEATH,
+  GAME_EVENT_TYPE_COUNT,
+} GameEventType;
+
+struct CBZ_API GameEvent {
+  GameEventType type;
+
+  // 'UNIT_ID_INVALID' if not applicable
+  unitId source;
+  unitId target;
+
+  // Type specific. 'StatusEffectType' of status damage and expiry.
+  uint32_t data;
+
+  real_t amount;
+  Position point;
+
+  // Merge order. Events with equal keys keep their append order.
+  uint64_t orderKey;
+};
+
+// @brief Append only event buffer owned by one writer during a phase.
+struct CBZ_API alignas(64) GameEventBuffer {
+  std::vector<GameEvent> events;
+};
+
+// @brief Gameplay events of a step.
+// @note Each writer appends to its own buffer without synchronization. At the
+// end of a phase 'GameEventQueueMerge' moves all buffered events into
+// 'events' ordered by 'orderKey' so the result does not depend on which
+// thread wrote what. An order key must only be used by one writer per phase,
+// e.g. the index of the item being processed.
+struct CBZ_API GameEventQueue {
+  GameEventBuffer buffers[GAME_EVENT_MAX_WRITERS];
+
+  // Merged events of all phases so far
+  std::vector<GameEvent> events;
+};
+
+// @brief Clears merged and buffered events. Buffers keep their capacity.
+CBZ_API void GameEventQueueReset(GameEventQueue *queue);
+
+// @brief Builds an order key sorting by 'phase' then 'itemIdx'.
+CBZ_API CBZ_NO_DISCARD uint64_t GameEventOrderKey(uint32_t phase,
+                                                  uint32_t itemIdx);
+
+// @returns writer index of the calling thread, its 'JobSystemThreadIndex'.
+// @note Threads outside the job system write as the main thread and must not
+// run alongside it.
+CBZ_API CBZ_NO_DISCARD uint32_t GameEventWriterIndex();
+
+inline void GameEventAppend(GameEventQueue *queue, uint32_t writerIdx,
+                            const GameEvent &event) {
+  queue->buffers[writerIdx].events.push_back(event);
+}
+
+// @brief Appends to the buffer of the calling thread.
+inline void GameEventAppend(GameEventQueue *queue, const GameEvent &event) {
+  GameEventAppend(queue, GameEventWriterIndex(), event);
+}
+
+// @brief Ends a phase. Appends buffered events to 'events' in order key order
+// and clears the buffers.
+// @note Must not run concurrently with writers.
+CBZ_API void GameEventQueueMerge(GameEventQueue *queue);
+
+// @brief Events of the last 'Step' in deterministic order. Valid until the
+// next 'Step'.
+CBZ_API CBZ_NO_DISCARD const std::vector<GameEvent> &GetGameEvents();
+
+}; // namespace rts
+
+#endif // RTS_EVENTS_H_
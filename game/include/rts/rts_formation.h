@@ -0,0 +1,40 @@
+#ifndef RTS_FORMATION_H_
+#define RTS_FORMATION_H_
+
+#include "rts/rts.h"
+
+namespace rts {
+
+struct CBZ_API FormationSlot {
+  // Relative to the formation center. 'x' is right, 'y' is forward.
+  Vec2 offset;
+
+  // 0 is the front row
+  uint32_t row;
+};
+
+// @brief Lays out 'count' slots for 'type' centered on the origin. Slots are
+// written row by row from the front, left to right.
+CBZ_API void FormationSlotsCreate(FormationType type, uint32_t count,
+                                  float spacing, FormationSlot *outSlots);
+
+// @brief Transforms slot offsets to world x/z positions around 'center'
+// facing 'forward' (normalized, x/z).
+CBZ_API void FormationSlotsPlace(const FormationSlot *slots, uint32_t count,
+                                 Vec2 center, Vec2 forward, Vec2 *outPositions);
+
+// @brief Assigns each unit a slot so paths rarely cross.
+// @note Approximates the optimal assignment in O(n log n) instead of running
+// the Hungarian algorithm: units are sorted by how far forward they are and
+// split into the formation's rows, then matched left to right within each
+// row. A pass of neighbor swaps then fixes the worst local mismatches.
+// @param unitPositions world x/z
+// @param outSlotIdxs slot index per unit
+CBZ_API void FormationAssign(const FormationSlot *slots,
+                             const Vec2 *slotPositions,
+                             const Vec2 *unitPositions, uint32_t count,
+                             Vec2 forward, uint32_t *outSlotIdxs);
+
+}; // namespace rts
+
+#endif // RTS_FORMATION_H_
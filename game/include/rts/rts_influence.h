@@ -0,0 +1,65 @@
+#ifndef RTS_INFLUENCE_H_
+#define RTS_INFLUENCE_H_
+
+#include "rts/rts.h"
+#include "rts/rts_cost_field.h"
+
+namespace rts {
+
+// Fine grid cells per influence cell (per axis)
+#define INFLUENCE_CELL_SIZE 4
+#define INFLUENCE_X (GRID_X / INFLUENCE_CELL_SIZE)
+#define INFLUENCE_Y (GRID_Y / INFLUENCE_CELL_SIZE)
+
+// Steps between updates of a team's layer
+#define INFLUENCE_UPDATE_INTERVAL 6
+
+struct CBZ_API InfluenceSettings {
+  // Fraction of influence kept per update
+  float decay = 0.85f;
+
+  // Influence added per unit of strength
+  float strengthScale = 1.0f;
+};
+
+// @brief Per team influence layers on a coarse grid.
+// @note Each update decays and blurs a layer with a separable [1 2 1] kernel
+// so influence spreads out over time, then splats the team's units on top.
+// Layers are updated independently so teams can be spread over several
+// steps.
+struct CBZ_API InfluenceMap {
+  alignas(32) float layers[TEAM_COUNT][INFLUENCE_X * INFLUENCE_Y];
+
+  // Blur pass output
+  alignas(32) float scratch[INFLUENCE_X * INFLUENCE_Y];
+};
+
+CBZ_API void InfluenceMapInit(InfluenceMap *map);
+
+// @brief Decays, blurs and splats the layer of 'team'.
+// @param positionsX unit positions in fine grid cell space
+// @param strengths influence of each unit, e.g. its damage
+CBZ_API void InfluenceLayerUpdate(InfluenceMap *map, uint32_t team,
+                                  const float *positionsX,
+                                  const float *positionsY,
+                                  const float *strengths, uint32_t count,
+                                  const InfluenceSettings &settings = {});
+
+// @brief Finds the strongest influence of 'team' inside 'region' (in fine
+// grid cells).
+// @returns the influence. 'outCell' is set to the fine grid cell at the
+// center of the influence cell found.
+CBZ_API float InfluenceRegionMax(const InfluenceMap *map, uint32_t team,
+                                 CellRect region, IVec2 *outCell = nullptr);
+
+// @brief Finds the weakest influence of 'team' inside 'region'.
+CBZ_API float InfluenceRegionMin(const InfluenceMap *map, uint32_t team,
+                                 CellRect region, IVec2 *outCell = nullptr);
+
+// @brief Influence of the simulation. Each team is updated every
+// 'INFLUENCE_UPDATE_INTERVAL' steps with units weighted by their damage.
+CBZ_API CBZ_NO_DISCARD const InfluenceMap *GetInfluenceMap();
+
+}; // namespace rts
+
+#endif // RTS_INFLUENCE_H_
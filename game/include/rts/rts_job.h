@@ -0,0 +1,99 @@
+#ifndef RTS_JOB_H_
+#define RTS_JOB_H_
+
+#include "rts/rts.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rts {
+
+// Threads a job system can run on, including the main thread
+#define JOB_MAX_THREADS 64
+
+// Thread index of threads outside the job system
+#define JOB_THREAD_INDEX_NONE UINT32_MAX
+
+typedef enum : uint32_t {
+  JOB_FLAGS_NONE = 0,
+
+  // Runs on the thread that called 'JobSystemInit', e.g. for GPU calls. Main
+  // thread jobs run in submission order whenever that thread waits.
+  JOB_FLAGS_MAIN_THREAD = 1 << 0,
+} JobFlags;
+
+// @brief Number of unfinished jobs submitted with it. Jobs depend on each
+// other by waiting on counters.
+struct CBZ_API JobCounter {
+  std::atomic<uint32_t> value{0};
+};
+
+struct CBZ_API Job {
+  std::function<void()> fn;
+  JobCounter *counter;
+};
+
+// @brief Jobs of one thread. The owner pushes and pops at the back, idle
+// threads steal from the front.
+struct CBZ_API JobDeque {
+  std::mutex mutex;
+  std::deque<Job> jobs;
+};
+
+// @brief One pool of threads shared by every system that runs work in
+// parallel. Each thread has its own deque and steals from the others when it
+// runs dry, so there is no shared queue to contend on.
+// @note The thread calling 'JobSystemInit' is thread 0, the main thread.
+struct CBZ_API JobSystem {
+  JobDeque deques[JOB_MAX_THREADS];
+  JobDeque mainThreadJobs;
+  uint32_t threadCount;
+
+  // Jobs waiting in 'deques' and 'mainThreadJobs'. Idle threads sleep until
+  // there are some they can run.
+  std::atomic<uint32_t> queuedCount;
+  std::atomic<uint32_t> queuedMainCount;
+
+  std::vector<std::thread> workers;
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::atomic<bool> isStopping;
+};
+
+// @param workerCount threads besides the calling thread
+CBZ_API void JobSystemInit(JobSystem *jobs, uint32_t workerCount);
+
+// @brief Stops the workers. Jobs still queued are dropped.
+CBZ_API void JobSystemShutdown(JobSystem *jobs);
+
+// @brief Queues 'fn' on the calling thread's deque. 'counter' is incremented
+// now and decremented once 'fn' returns.
+CBZ_API void JobSystemSubmit(JobSystem *jobs, std::function<void()> fn,
+                             JobCounter *counter,
+                             uint32_t flags = JOB_FLAGS_NONE);
+
+// @brief Runs queued jobs until 'counter' reaches 0.
+// @note Jobs may wait too, but not on work that can only finish after they
+// return. It may run on their thread below them.
+CBZ_API void JobSystemWait(JobSystem *jobs, JobCounter *counter);
+
+// @brief Calls 'fn(begin, end)' over [0, count) in chunks of 'grainSize' and
+// returns once every chunk is done.
+// @note At most one job per thread is queued. Each claims chunks until none
+// are left, so uneven chunks balance out.
+CBZ_API void
+JobSystemParallelFor(JobSystem *jobs, uint32_t count, uint32_t grainSize,
+                     const std::function<void(uint32_t, uint32_t)> &fn);
+
+// @returns deque index of the calling thread, 0 for the main thread or
+// 'JOB_THREAD_INDEX_NONE' for threads outside the job system.
+CBZ_API CBZ_NO_DISCARD uint32_t JobSystemThreadIndex();
+
+}; // namespace rts
+
+#endif // RTS_JOB_H_
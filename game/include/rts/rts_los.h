@@ -0,0 +1,42 @@
+#ifndef RTS_LOS_H_
+#define RTS_LOS_H_
+
+#include "rts/rts.h"
+
+namespace rts {
+
+#define BLOCKING_WORDS_PER_ROW (GRID_X / 32)
+
+// @brief One bit per cell, set if the cell blocks line of sight.
+struct CBZ_API BlockingBitplane {
+  uint32_t words[GRID_Y * BLOCKING_WORDS_PER_ROW];
+};
+
+struct CBZ_API LineOfSightQuery {
+  IVec2 from;
+  IVec2 to;
+};
+
+// @brief Packs impassable cells of 'costField' into 'out'.
+CBZ_API void BlockingBitplaneCreate(const int *costField,
+                                    BlockingBitplane *out);
+
+CBZ_API void BlockingBitplaneSet(BlockingBitplane *plane, IVec2 cell,
+                                 bool isBlocking);
+
+// @brief Tests line of sight for a batch of queries.
+// @note Tests every cell the segment between the centers of 'from' and 'to'
+// touches, including both cells of a corner it passes exactly through, so
+// sight never leaks between diagonal walls. Only cells strictly between the
+// endpoints are tested so units standing on blocking cells can still see and
+// be seen. Queries with an endpoint off the grid are not visible. Queries are
+// traversed in packets of 8.
+// @param outVisible bit 'i' is set if query 'i' has line of sight. Must hold
+// (count + 63) / 64 words.
+CBZ_API void LineOfSightBatch(const BlockingBitplane *plane,
+                              const LineOfSightQuery *queries, uint32_t count,
+                              uint64_t *outVisible);
+
+}; // namespace rts
+
+#endif // RTS_LOS_H_
@@ -0,0 +1,74 @@
+#ifndef RTS_MINIMAP_H_
+#define RTS_MINIMAP_H_
+
+#include "rts/rts.h"
+#include "rts/rts_cost_field.h"
+#include "rts/rts_unit_grid.h"
+
+#include <vector>
+
+namespace rts {
+
+// Fine grid cells per minimap pixel (per axis)
+#define MINIMAP_CELL_SIZE 2
+#define MINIMAP_X (GRID_X / MINIMAP_CELL_SIZE)
+#define MINIMAP_Y (GRID_Y / MINIMAP_CELL_SIZE)
+
+// Frames between unit rasterizations
+#define MINIMAP_UNIT_UPDATE_INTERVAL 4
+
+// Same layout as an RGBA8 texel
+struct CBZ_API MinimapPixel {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t a;
+};
+
+// @brief RGBA raster of terrain, obstacles, fog and unit dots.
+// @note Pixels are only recolored when they change: terrain when the cost
+// field sector under them changes version or their fog changes, units every
+// 'MINIMAP_UNIT_UPDATE_INTERVAL' frames, restoring the terrain under last
+// raster's dots. Rows written are tracked so uploads can be skipped or
+// narrowed.
+struct CBZ_API Minimap {
+  // Terrain, obstacles and fog
+  std::vector<MinimapPixel> background;
+
+  // 'background' with unit dots on top
+  std::vector<MinimapPixel> pixels;
+
+  std::vector<uint8_t> fogged;
+
+  // Pixels waiting for their background to be recolored
+  std::vector<uint32_t> dirtyPixels;
+  std::vector<uint8_t> isPixelDirty;
+
+  // Pixels covered by unit dots
+  std::vector<uint32_t> unitPixels;
+
+  // Cost field sector versions 'background' was built from
+  std::vector<uint32_t> sectorVersions;
+
+  // Rows of 'pixels' written since 'MinimapClearDirtyRows'. Empty if
+  // 'dirtyRowMin > dirtyRowMax'.
+  int dirtyRowMin;
+  int dirtyRowMax;
+};
+
+// @brief Everything starts dirty and unfogged.
+CBZ_API void MinimapInit(Minimap *minimap);
+
+// @brief Fogs or reveals the pixel covering 'cell'.
+CBZ_API void MinimapSetFog(Minimap *minimap, IVec2 cell, bool isFogged);
+
+// @brief Recolors changed pixels. Units are rasterized from 'unitGrid' every
+// 'MINIMAP_UNIT_UPDATE_INTERVAL' frames and hidden under fog.
+CBZ_API void MinimapUpdate(Minimap *minimap, const CostField *costField,
+                           const UnitGrid *unitGrid, uint64_t frameIdx);
+
+CBZ_API void MinimapClearDirtyRows(Minimap *minimap);
+
+}; // namespace rts
+
+#endif // RTS_MINIMAP_H_
@@ -0,0 +1,85 @@
+#ifndef RTS_PROJECTILE_H_
+#define RTS_PROJECTILE_H_
+
+#include "rts/rts.h"
+#include "rts/rts_los.h"
+#include "rts/rts_unit_grid.h"
+
+#include <vector>
+
+namespace rts {
+
+#define PROJECTILE_CAPACITY 32768
+
+// Largest projectile radius. Keeps hits within the neighboring buckets.
+#define PROJECTILE_MAX_RADIUS 0.5f
+
+struct CBZ_API ProjectileDesc {
+  Position origin;
+
+  // World units per second on the x/z plane
+  Vec2 velocity;
+
+  real_t radius;
+  real_t damage;
+
+  // Distance travelled before the projectile expires
+  real_t range;
+
+  // Never hit by its own projectiles. 'UNIT_ID_INVALID' if none.
+  unitId owner;
+};
+
+struct CBZ_API ProjectileHit {
+  unitId owner;
+
+  // 'UNIT_ID_INVALID' if a blocking cell was hit
+  unitId target;
+
+  Position point;
+  real_t damage;
+};
+
+// @brief Fixed capacity projectile pool in SoA. Active projectiles are kept
+// dense in [0, count).
+// @note Positions are in fine grid cell space.
+struct CBZ_API ProjectilePool {
+  uint32_t count;
+
+  // Spawns rejected since the last step because the pool was full
+  uint32_t droppedCount;
+
+  float positionsX[PROJECTILE_CAPACITY];
+  float positionsY[PROJECTILE_CAPACITY];
+  float velocitiesX[PROJECTILE_CAPACITY];
+  float velocitiesY[PROJECTILE_CAPACITY];
+  float radii[PROJECTILE_CAPACITY];
+  float rangesLeft[PROJECTILE_CAPACITY];
+  real_t damages[PROJECTILE_CAPACITY];
+  unitId owners[PROJECTILE_CAPACITY];
+};
+
+CBZ_API void ProjectilePoolInit(ProjectilePool *pool);
+
+// @returns false if the pool is full. Dropped spawns are reported once per
+// step.
+CBZ_API bool ProjectileSpawn(ProjectilePool *pool, const ProjectileDesc &desc);
+
+// @brief Moves every projectile by 'deltaTime' and sweeps its segment through
+// the grid. The first unit or blocking cell on the segment is hit and the
+// projectile removed.
+// @note Cells are traversed in order with a DDA. Units are tested per unit
+// grid bucket entered, including its neighbors, and blocking cells per cell.
+// Removed projectiles are swapped with the last one. Hit order is
+// deterministic but not spawn order.
+CBZ_API void ProjectilePoolStep(ProjectilePool *pool, float deltaTime,
+                                const BlockingBitplane *plane,
+                                const UnitGrid *unitGrid,
+                                std::vector<ProjectileHit> *outHits);
+
+// @brief Projectiles of the simulation. Hits damage units every step.
+CBZ_API CBZ_NO_DISCARD ProjectilePool *GetProjectiles();
+
+}; // namespace rts
+
+#endif // RTS_PROJECTILE_H_
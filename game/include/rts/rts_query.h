@@ -0,0 +1,116 @@
+#ifndef RTS_QUERY_H_
+#define RTS_QUERY_H_
+
+#include "rts/rts.h"
+
+#include <cbz_ecs/cbz_ecs.h>
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rts {
+
+#define QUERY_CACHE_VERSION_NONE UINT64_MAX
+
+// @brief Invalidates every query cache of 'world'. Call after adding or
+// removing components outside of 'QueryAddComponent'.
+// @note Versions are kept per world so changes to one world, e.g. the
+// simulation's, leave caches of the others alone.
+CBZ_API void QueryStructureMarkDirty(const cbz::ecs::IWorld *world);
+
+// @returns the structure version of 'world', bumped by every
+// 'QueryStructureMarkDirty' of it.
+CBZ_API CBZ_NO_DISCARD uint64_t
+QueryStructureVersion(const cbz::ecs::IWorld *world);
+
+// @brief Adds 'T' to 'e' of 'world' and invalidates its query caches. Use
+// instead of 'addComponent' on entities of worlds that are queried through
+// caches.
+template <typename T, typename... Args>
+T &QueryAddComponent(cbz::ecs::IWorld *world, cbz::ecs::Entity e,
+                     Args &&...args) {
+  T &component = e.addComponent<T>(std::forward<Args>(args)...);
+  QueryStructureMarkDirty(world);
+  return component;
+}
+
+// @brief Entities with every component in 'Ts' and pointers to those
+// components. Kept between calls so hot loops skip matching and lookups.
+// @note Component pointers are only valid while the world's structure is
+// unchanged. The cache rebuilds whenever the world's structure version
+// changed. A cache must only be updated with one world.
+template <typename... Ts> struct QueryCache {
+  std::vector<cbz::ecs::EntityId> entities;
+
+  // 'entities[i]' has components 'std::get<std::vector<T *>>(components)[i]'.
+  // These are arrays of pointers into the world, not contiguous components.
+  std::tuple<std::vector<Ts *>...> components;
+
+  uint64_t structureVersion = QUERY_CACHE_VERSION_NONE;
+};
+
+// @brief Cache type of a query that may start with 'cbz::ecs::Entity'.
+template <typename... Ts> struct QueryCacheOf {
+  using Type = QueryCache<Ts...>;
+};
+
+template <typename... Ts> struct QueryCacheOf<cbz::ecs::Entity, Ts...> {
+  using Type = QueryCache<Ts...>;
+};
+
+// @brief Rematches the world if the structure version changed since the last
+// update.
+// @returns true if the cache was rebuilt.
+template <typename... Ts>
+bool QueryCacheUpdate(QueryCache<Ts...> *cache, cbz::ecs::IWorld *world) {
+  const uint64_t structureVersion = QueryStructureVersion(world);
+  if (cache->structureVersion == structureVersion) {
+    return false;
+  }
+
+  cache->structureVersion = structureVersion;
+  cache->entities.clear();
+  (std::get<std::vector<Ts *>>(cache->components).clear(), ...);
+
+  world->query<cbz::ecs::Entity, Ts...>(
+      [cache](cbz::ecs::Entity e, Ts &...components) {
+        cache->entities.push_back(e.getId());
+        (std::get<std::vector<Ts *>>(cache->components).push_back(&components),
+         ...);
+      });
+
+  return true;
+}
+
+template <typename... Ts>
+inline uint32_t QueryCacheCount(const QueryCache<Ts...> *cache) {
+  return static_cast<uint32_t>(cache->entities.size());
+}
+
+// @returns pointers to 'T' of every cached entity in entity order.
+template <typename T, typename... Ts>
+inline T *const *QueryCacheComponents(const QueryCache<Ts...> *cache) {
+  return std::get<std::vector<T *>>(cache->components).data();
+}
+
+// @brief Calls 'fn' for each cached entity, with its 'cbz::ecs::Entity'
+// first if 'fn' takes one.
+template <typename... Ts, typename Fn>
+void QueryCacheForEach(const QueryCache<Ts...> *cache, cbz::ecs::IWorld *world,
+                       Fn &&fn) {
+  const uint32_t count = QueryCacheCount(cache);
+  for (uint32_t i = 0; i < count; i++) {
+    if constexpr (std::is_invocable_v<Fn &, cbz::ecs::Entity, Ts &...>) {
+      fn(cbz::ecs::Entity(cache->entities[i], world),
+         *QueryCacheComponents<Ts>(cache)[i]...);
+    } else {
+      fn(*QueryCacheComponents<Ts>(cache)[i]...);
+    }
+  }
+}
+
+}; // namespace rts
+
+#endif // RTS_QUERY_H_
@@ -0,0 +1,189 @@
+#ifndef RTS_SCHEDULER_H_
+#define RTS_SCHEDULER_H_
+
+#include "rts/rts.h"
+#include "rts/rts_change.h"
+#include "rts/rts_job.h"
+#include "rts/rts_query.h"
+
+#include <cbz_ecs/cbz_ecs.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+namespace rts {
+
+// Components and resources a scheduler can tell apart
+#define SYSTEM_MAX_ACCESS_TYPES 64
+
+typedef uint64_t SystemAccessMask;
+
+typedef enum : uint32_t {
+  SYSTEM_FLAGS_NONE = 0,
+
+  // Runs on the job system's main thread, e.g. for GPU calls. Main thread
+  // systems run in the order they were added.
+  SYSTEM_FLAGS_MAIN_THREAD = 1 << 0,
+
+  // Runs alone, e.g. for structural changes to the world
+  SYSTEM_FLAGS_EXCLUSIVE = 1 << 1,
+} SystemFlags;
+
+struct CBZ_API SystemAccess {
+  SystemAccessMask reads;
+  SystemAccessMask writes;
+};
+
+// @returns the access bit of 'type', assigned on first use.
+// @note The registry lives in the game library so every module sees the same
+// bit for a type.
+CBZ_API CBZ_NO_DISCARD uint32_t SystemAccessTypeOf(const std::type_info &type);
+
+// @returns the access bit of component or resource 'T'.
+template <typename T> uint32_t SystemAccessType() {
+  // Caches the registry's answer, which is the same in every module
+  static const uint32_t type = SystemAccessTypeOf(typeid(T));
+  return type;
+}
+
+template <typename... Ts> SystemAccess SystemReads() {
+  return {((SystemAccessMask(1) << SystemAccessType<Ts>()) | ... | 0), 0};
+}
+
+template <typename... Ts> SystemAccess SystemWrites() {
+  return {0, ((SystemAccessMask(1) << SystemAccessType<Ts>()) | ... | 0)};
+}
+
+inline SystemAccess operator|(SystemAccess a, SystemAccess b) {
+  return {a.reads | b.reads, a.writes | b.writes};
+}
+
+// @brief Access of a system parameter. 'const T &' and 'T' read, 'T &'
+// writes. Entities are not tracked.
+template <typename Param> SystemAccess SystemParamAccess() {
+  using T = std::remove_cv_t<std::remove_reference_t<Param>>;
+  if constexpr (std::is_same_v<T, cbz::ecs::Entity>) {
+    return {0, 0};
+  } else if constexpr (std::is_lvalue_reference_v<Param> &&
+                       !std::is_const_v<std::remove_reference_t<Param>>) {
+    return SystemWrites<T>();
+  } else {
+    return SystemReads<T>();
+  }
+}
+
+template <typename Fn>
+struct SystemFnTraits : SystemFnTraits<decltype(&Fn::operator())> {};
+
+template <typename C, typename R, typename... Params>
+struct SystemFnTraits<R (C::*)(Params...) const> {
+  static SystemAccess Access() {
+    return (SystemParamAccess<Params>() | ... | SystemAccess{0, 0});
+  }
+};
+
+struct CBZ_API SystemDesc {
+  const char *name;
+  SystemAccess access;
+  uint32_t flags;
+  std::function<void(cbz::ecs::IWorld *)> fn;
+
+  // Optional. Runs while no system does, before 'fn' and again after every
+  // exclusive system, e.g. to refresh query caches so 'fn' never queries the
+  // world from a worker.
+  std::function<void(cbz::ecs::IWorld *)> prepare;
+};
+
+// @brief Runs systems as a dependency graph instead of one after another.
+// @note A system waits on earlier systems it conflicts with: one writes what
+// the other reads or writes, either is exclusive or both are main thread
+// only. Everything else runs concurrently as jobs. Systems off the main thread
+// must not change the world's structure.
+struct CBZ_API SystemScheduler {
+  std::vector<SystemDesc> systems;
+
+  // Systems to release when system 'i' finishes are
+  // [dependentStarts[i], dependentStarts[i + 1]) of 'dependents'
+  std::vector<uint32_t> dependentStarts;
+  std::vector<uint32_t> dependents;
+  std::vector<uint32_t> dependencyCounts;
+  bool isGraphDirty;
+
+  // Advanced after every run. Writes are marked with the current tick in the
+  // table of the written component.
+  uint64_t changeTick;
+  ChangeTicks changes[SYSTEM_MAX_ACCESS_TYPES];
+
+  // --- Run state ---
+  JobSystem *jobs;
+  cbz::ecs::IWorld *world;
+
+  // Unfinished dependencies of each system. Systems are submitted as jobs
+  // once theirs reach 0.
+  std::unique_ptr<std::atomic<uint32_t>[]> waitCounts;
+};
+
+// @param jobs runs the systems
+CBZ_API void SystemSchedulerInit(SystemScheduler *scheduler, JobSystem *jobs);
+CBZ_API void SystemSchedulerShutdown(SystemScheduler *scheduler);
+
+CBZ_API void SystemSchedulerAdd(SystemScheduler *scheduler,
+                                const SystemDesc &desc);
+
+// @brief Marks component 'T' of 'eId' as written.
+// @note Only call from systems that write 'T' or outside of runs, which keeps
+// each change table to one thread at a time.
+template <typename T>
+void SystemSchedulerMarkChanged(SystemScheduler *scheduler,
+                                cbz::ecs::EntityId eId) {
+  ChangeTicksMark(&scheduler->changes[SystemAccessType<T>()], eId,
+                  scheduler->changeTick);
+}
+
+template <typename T>
+const ChangeTicks *SystemSchedulerChanges(const SystemScheduler *scheduler) {
+  return &scheduler->changes[SystemAccessType<T>()];
+}
+
+// @brief Adds a system that runs 'fn' for each entity with 'Ts'. Access is
+// taken from the parameters of 'fn' plus 'extraAccess' for resources it
+// touches outside the world.
+// @note Matches are cached until the structure version changes. The cache is
+// refreshed in 'prepare'.
+template <typename... Ts, typename Fn>
+void SystemSchedulerAddForEach(SystemScheduler *scheduler, const char *name,
+                               Fn fn, uint32_t flags = SYSTEM_FLAGS_NONE,
+                               SystemAccess extraAccess = {0, 0}) {
+  auto cache = std::make_shared<typename QueryCacheOf<Ts...>::Type>();
+
+  SystemDesc desc;
+  desc.name = name;
+  desc.access = SystemFnTraits<Fn>::Access() | extraAccess;
+  desc.flags = flags;
+  desc.fn = [fn, cache](cbz::ecs::IWorld *world) mutable {
+    QueryCacheForEach(cache.get(), world, fn);
+  };
+  desc.prepare = [cache](cbz::ecs::IWorld *world) {
+    QueryCacheUpdate(cache.get(), world);
+  };
+  SystemSchedulerAdd(scheduler, desc);
+}
+
+// @brief Runs every system once and returns when all are done. The calling
+// thread runs every 'prepare' first and helps with jobs meanwhile.
+// @note Main thread systems only run while the job system's main thread
+// waits, so call this from the main thread if there are any.
+// @note Systems filtering on changes since their last run should pass the
+// 'changeTick' they last ran at. Writes from systems that ran after them in
+// that run are then still seen, at the cost of seeing their own run's writes
+// once more.
+CBZ_API void SystemSchedulerRun(SystemScheduler *scheduler,
+                                cbz::ecs::IWorld *world);
+
+}; // namespace rts
+
+#endif // RTS_SCHEDULER_H_
@@ -0,0 +1,23 @@
+#ifndef RTS_SELECTION_H_
+#define RTS_SELECTION_H_
+
+#include "rts/rts.h"
+#include "rts/rts_unit_grid.h"
+
+#include <vector>
+
+namespace rts {
+
+// @brief Appends the units of 'grid' that project inside a screen rectangle.
+// @note Units are treated as points on the ground plane (y = 0). Only buckets
+// under the rectangle's footprint on the ground are visited, then their units
+// are projected 4 at a time.
+// @param viewProj column major projection * view matrix
+// @param ndcMin, ndcMax rectangle corners in normalized device coordinates
+CBZ_API void SelectUnitsInRect(const UnitGrid *grid, const float *viewProj,
+                               Vec2 ndcMin, Vec2 ndcMax,
+                               std::vector<unitId> *outUnits);
+
+}; // namespace rts
+
+#endif // RTS_SELECTION_H_
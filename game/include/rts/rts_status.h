@@ -0,0 +1,99 @@
+#ifndef RTS_STATUS_H_
+#define RTS_STATUS_H_
+
+#include "rts/rts.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace rts {
+
+typedef enum : uint32_t {
+  STATUS_EFFECT_TYPE_BLEED = 0,
+  STATUS_EFFECT_TYPE_ROT,
+  STATUS_EFFECT_TYPE_COUNT,
+} StatusEffectType;
+
+struct CBZ_API StatusEffectDesc {
+  // Ticks until expiry after the last application. 0 never expires.
+  uint32_t durationTicks;
+
+  // Ticks between damage ticks. 0 never ticks.
+  uint32_t periodTicks;
+
+  real_t damagePerStack;
+  uint32_t maxStacks;
+};
+
+CBZ_API CBZ_NO_DISCARD const StatusEffectDesc &
+StatusEffectDescGet(StatusEffectType type);
+
+struct CBZ_API StatusEffectEvent {
+  unitId unit;
+  StatusEffectType type;
+  uint32_t stacks;
+
+  // Damage dealt this tick. 0 on expiry.
+  real_t damage;
+  CBZBool32 expired;
+};
+
+// Hierarchical timing wheel: 4 levels of 64 slots, 2^24 ticks of range
+#define STATUS_WHEEL_LEVELS 4
+#define STATUS_WHEEL_SLOT_BITS 6
+#define STATUS_WHEEL_SLOTS (1 << STATUS_WHEEL_SLOT_BITS)
+
+// @brief Active status effects in SoA, keyed by (unit, type).
+// @note Each effect has a single timer on the wheel for its next event
+// (damage tick or expiry). Stepping only touches the slots due this tick, so
+// the cost scales with effects firing rather than units affected.
+struct CBZ_API StatusEffectPool {
+  // --- Effects (SoA) ---
+  std::vector<unitId> units;
+  std::vector<StatusEffectType> types;
+  std::vector<uint32_t> stacks;
+  std::vector<uint64_t> expiryTicks;
+  std::vector<uint64_t> nextPeriodTicks;
+
+  // --- Timers (intrusive lists per slot) ---
+  std::vector<uint64_t> deadlines;
+  std::vector<uint32_t> timerNext;
+  std::vector<uint32_t> timerPrev;
+  std::vector<uint32_t> timerSlot;
+  uint32_t slotHeads[STATUS_WHEEL_LEVELS * STATUS_WHEEL_SLOTS];
+
+  std::vector<uint32_t> freeEffects;
+  std::unordered_map<uint64_t, uint32_t> effectLookup;
+
+  uint64_t tick;
+};
+
+CBZ_API void StatusEffectPoolInit(StatusEffectPool *pool);
+
+// @brief Adds stacks to (unit, type), creating the effect if needed, and
+// refreshes its expiry.
+CBZ_API void StatusEffectApply(StatusEffectPool *pool, unitId unit,
+                               StatusEffectType type, uint32_t stacks = 1);
+
+CBZ_API void StatusEffectRemove(StatusEffectPool *pool, unitId unit,
+                                StatusEffectType type);
+
+// @brief Removes all effects on 'unit'. Use on death/despawn.
+CBZ_API void StatusEffectRemoveAll(StatusEffectPool *pool, unitId unit);
+
+// @returns the number of stacks of 'type' on 'unit'. 0 if none.
+CBZ_API CBZ_NO_DISCARD uint32_t StatusEffectGetStacks(
+    const StatusEffectPool *pool, unitId unit, StatusEffectType type);
+
+// @brief Advances the wheel by one tick and appends fired effects to
+// 'outEvents'.
+CBZ_API void StatusEffectPoolStep(StatusEffectPool *pool,
+                                  std::vector<StatusEffectEvent> *outEvents);
+
+// @brief Status effects of the simulation. Damage ticks are applied to unit
+// health every step.
+CBZ_API CBZ_NO_DISCARD StatusEffectPool *GetStatusEffects();
+
+}; // namespace rts
+
+#endif // RTS_STATUS_H_
@@ -0,0 +1,47 @@
+#ifndef RTS_UNIT_GRID_H_
+#define RTS_UNIT_GRID_H_
+
+#include "rts/rts.h"
+
+#include <vector>
+
+namespace rts {
+
+// Fine grid cells per unit grid bucket (per axis)
+#define UNIT_GRID_CELL_SIZE 2
+#define UNIT_GRID_X (GRID_X / UNIT_GRID_CELL_SIZE)
+#define UNIT_GRID_Y (GRID_Y / UNIT_GRID_CELL_SIZE)
+
+// Collision radius of a unit in fine grid cells
+#define UNIT_RADIUS 0.4f
+
+// @brief Alive units bucketed by position, rebuilt every step.
+// @note Buckets are stored compressed: units of bucket 'i' are
+// [bucketStarts[i], bucketStarts[i + 1]) with their positions alongside.
+struct CBZ_API UnitGrid {
+  std::vector<uint32_t> bucketStarts;
+  std::vector<unitId> units;
+
+  // Fine grid cell space, sorted like 'units'
+  std::vector<float> positionsX;
+  std::vector<float> positionsY;
+
+  // Sorted like 'units'
+  std::vector<uint32_t> teams;
+};
+
+// @brief Buckets 'units' by 'positions' (in fine grid cell space) with a
+// counting sort.
+CBZ_API void UnitGridBuild(UnitGrid *grid, const unitId *units,
+                           const Vec2 *positions, const uint32_t *teams,
+                           uint32_t count);
+
+// @returns the bucket containing 'position' (in fine grid cell space).
+CBZ_API CBZ_NO_DISCARD IVec2 UnitGridBucket(Vec2 position);
+
+// @brief Unit grid of the simulation. Rebuilt from alive units every step.
+CBZ_API CBZ_NO_DISCARD const UnitGrid *GetUnitGrid();
+
+}; // namespace rts
+
+#endif // RTS_UNIT_GRID_H_
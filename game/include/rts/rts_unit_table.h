@@ -0,0 +1,74 @@
+#ifndef RTS_UNIT_TABLE_H_
+#define RTS_UNIT_TABLE_H_
+
+#include "rts/rts.h"
+
+#include <vector>
+
+namespace rts {
+
+#define UNIT_ASSET_ID_INVALID UINT32_MAX
+
+// FNV-1a offset basis. Starts a 'UnitTableHash' chain.
+#define UNIT_TABLE_HASH_SEED 0xcbf29ce484222325ull
+
+// Bump when 'UnitArchetype' or the cache layout changes
+#define UNIT_TABLE_VERSION 1
+
+// @brief Unit stats compiled from a unit definition.
+struct CBZ_API UnitArchetype {
+  real_t health;
+  real_t mana;
+  real_t damage;
+  real_t armor;
+  real_t movement_speed;
+
+  // Offset of the null terminated name in 'UnitTable::names'
+  uint32_t nameOffset;
+};
+
+// @brief Dense table of unit archetypes indexed by 'UnitAssetId'.
+struct CBZ_API UnitTable {
+  // Hash of the definitions the table was compiled from
+  uint64_t sourceHash;
+
+  std::vector<UnitArchetype> archetypes;
+  std::vector<char> names;
+};
+
+CBZ_API void UnitTableInit(UnitTable *table, uint64_t sourceHash);
+
+// @brief Appends an archetype with the stats of 'unit'. 'unit.name' is
+// copied into the table.
+CBZ_API UnitAssetId UnitTableAdd(UnitTable *table, const Unit &unit);
+
+// @returns the archetype named 'name'. 'UNIT_ASSET_ID_INVALID' if none.
+CBZ_API CBZ_NO_DISCARD UnitAssetId UnitTableFind(const UnitTable *table,
+                                                 const char *name);
+
+// @brief Expands archetype 'id' into a 'Unit'. 'name' points into 'table' and
+// is valid until the table is reloaded.
+CBZ_API CBZ_NO_DISCARD Unit UnitTableGet(const UnitTable *table,
+                                         UnitAssetId id);
+
+// @brief FNV-1a over 'size' bytes continuing from 'hash'. Chain calls starting
+// from 'UNIT_TABLE_HASH_SEED' to hash several sources.
+CBZ_API CBZ_NO_DISCARD uint64_t UnitTableHash(const void *data, size_t size,
+                                              uint64_t hash);
+
+// @brief Writes 'table' as a binary cache to 'path'.
+CBZ_API CBZ_NO_DISCARD cbz::Result UnitTableWrite(const UnitTable *table,
+                                                  const char *path);
+
+// @brief Reads the binary cache at 'path' into 'table'.
+// @returns 'eFailure' if the cache is stale (different 'sourceHash', version
+// or precision) or malformed.
+CBZ_API CBZ_NO_DISCARD cbz::Result
+UnitTableRead(UnitTable *table, const char *path, uint64_t sourceHash);
+
+// @brief Archetypes used by 'Spawn'.
+CBZ_API CBZ_NO_DISCARD UnitTable *GetUnitTable();
+
+}; // namespace rts
+
+#endif // RTS_UNIT_TABLE_H_
@@ -1,213 +1,1039 @@
 #include "rts/rts.h"
+#include "rts/rts_behavior.h"
+#include "rts/rts_cost_field.h"
+#include "rts/rts_crowd.h"
+#include "rts/rts_events.h"
+#include "rts/rts_formation.h"
+#include "rts/rts_influence.h"
+#include "rts/rts_projectile.h"
+#include "rts/rts_status.h"
+#include "rts/rts_unit_grid.h"
+#include "rts/rts_unit_table.h"
 #include "spdlog/spdlog.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <functional>
 #include <limits>
+#include <queue>
 
 #define CBZ_ECS_IMPLEMENTATION
 #include <cbz_ecs/cbz_ecs.h>
 
+// Includes cbz_ecs so it has to come after the implementation
+#include "rts/rts_scheduler.h"
+
 namespace rts {
 
+static constexpr float sStepDeltaTime = STEP_DELTA_TIME;
+
+// Minimum units created when the pool runs dry
+static constexpr uint32_t sUnitPoolGrowth = 64;
+
 static std::unique_ptr<cbz::ecs::IWorld> sWorld;
+static SystemScheduler sScheduler;
 static std::vector<cbz::ecs::Entity> sUnits;
+static std::vector<unitId> sFreeUnits;
+static UnitTable sUnitTable;
+
+// --- Pathing ---
+#define PATH_MAX_WAYPOINTS 256
+
+// Approximate cells an A* search touches per cell of distance squared
+static constexpr int sPathCellsPerDistanceSq = 2;
+
+// Cells touched building a flow field (integration + flow pass)
+static constexpr int sFlowFieldCells = 2 * GRID_X * GRID_Y;
+
+// Stale flow fields rebuilt per step. The rest keep steering units with
+// their previous field until their turn.
+static constexpr uint32_t sFlowFieldRebuildsPerStep = 2;
+
+// Distance to a waypoint considered reached
+static constexpr float sArrivalRadius = 0.1f;
+
+struct FlowFieldOrder {
+  int targetIdx;
+  uint32_t unitCount;
+  std::vector<Vec2> flowField;
+
+  // Cost field sector versions the flow field was built from
+  std::vector<uint32_t> sectorVersions;
+
+  // Sectors holding cells reached from the target or walls bordering them.
+  // Changes anywhere else cannot alter the field.
+  std::bitset<SECTOR_X * SECTOR_Y> dependentSectors;
+
+  // 'sStepIdx' of the last build. Oldest stale fields rebuild first.
+  uint64_t buildStepIdx;
+};
+
+static CostField sCostField;
+static std::vector<cbz::ecs::Entity> sObstacles;
+static std::vector<obstacleId> sFreeObstacles;
+static CrowdDensityField sCrowdDensity;
+
+static std::vector<std::vector<IVec2>> sPaths;
+static std::vector<uint32_t> sFreePaths;
+static std::vector<FlowFieldOrder> sFlowFieldOrders;
+static std::vector<uint32_t> sStaleFlowFieldOrders;
+
+// Reused by every flow field build
+static std::vector<int> sIntegrationFieldScratch;
+
+// --- Formations ---
+// Distance between neighboring slots
+static constexpr float sFormationSpacing = 1.2f;
+
+// Distance to its slot at which a unit leaves the shared route
+static constexpr float sFormationApproachRadius = 4.0f;
+
+static std::vector<unitId> sFormationUnits;
+static std::vector<Vec2> sFormationUnitPositions;
+static std::vector<FormationSlot> sFormationSlots;
+static std::vector<Vec2> sFormationSlotPositions;
+static std::vector<uint32_t> sFormationSlotIdxs;
+
+// Slot of each unit in 'sFormationUnits'
+static std::vector<Vec2> sFormationTargets;
+
+// --- Status Effects ---
+static StatusEffectPool sStatusEffects;
+static std::vector<StatusEffectEvent> sStatusEffectEvents;
+
+// --- Combat ---
+static ProjectilePool sProjectiles;
+static std::vector<ProjectileHit> sProjectileHits;
+
+static BlockingBitplane sBlockingPlane;
+
+// Cost field sector versions the blocking plane was built from
+static std::vector<uint32_t> sBlockingPlaneVersions;
+
+// --- Events ---
+typedef enum : uint32_t {
+  STEP_PHASE_STATUS_EFFECTS = 0,
+  STEP_PHASE_PROJECTILES,
+  STEP_PHASE_DEATHS,
+} StepPhase;
+
+static GameEventQueue sEvents;
+
+// --- Influence ---
+static InfluenceMap sInfluenceMap;
+static std::vector<float> sInfluencePositionsX;
+static std::vector<float> sInfluencePositionsY;
+static std::vector<float> sInfluenceStrengths;
+
+// --- Behavior ---
+static std::vector<BehaviorGroup *> sBehaviorGroups;
+
+static uint64_t sStepIdx;
+
+static UnitGrid sUnitGrid;
+static std::vector<unitId> sUnitGridUnits;
+static std::vector<Vec2> sUnitGridPositions;
+static std::vector<uint32_t> sUnitGridTeams;
+
+static void ReleaseMoveOrder(UnitMoveState &moveState) {
+  switch (moveState.moveType) {
+  case UNIT_MOVE_TYPE_PATH: {
+    sPaths[moveState.orderIdx].clear();
+    sFreePaths.push_back(moveState.orderIdx);
+  } break;
+  case UNIT_MOVE_TYPE_FLOW_FIELD: {
+    FlowFieldOrder &order = sFlowFieldOrders[moveState.orderIdx];
+    if (--order.unitCount == 0) {
+      order.targetIdx = -1;
+      order.flowField.clear();
+      order.flowField.shrink_to_fit();
+      order.sectorVersions.clear();
+      order.dependentSectors.reset();
+    }
+  } break;
+  case UNIT_MOVE_TYPE_SLOT:
+  case UNIT_MOVE_TYPE_NONE:
+    break;
+  }
+
+  moveState.moveType = UNIT_MOVE_TYPE_NONE;
+  moveState.isMoving = false;
+}
+
+// @brief Ends the shared route of an order. Units with a formation slot go on
+// to steer straight to it.
+static void MoveOrderArrive(UnitMoveState &moveState) {
+  ReleaseMoveOrder(moveState);
+
+  if (moveState.hasSlot) {
+    moveState.moveType = UNIT_MOVE_TYPE_SLOT;
+    moveState.isMoving = true;
+  }
+}
+
+static void FlowFieldOrderBuild(FlowFieldOrder &order) {
+  const IVec2 target = {order.targetIdx % GRID_X, order.targetIdx / GRID_X};
+
+  // The target's own cost is never paid, so the live cost field is used as is
+  std::vector<int> &integrationField = sIntegrationFieldScratch;
+  integrationField.resize(GRID_X * GRID_Y);
+  IntegrationFieldCreate(sCostField.costs.data(), target, GRID_X,
+                         integrationField.data());
+
+  order.flowField.resize(GRID_X * GRID_Y);
+  FlowFieldCreate(integrationField.data(), target, GRID_X,
+                  order.flowField.data());
+
+  order.dependentSectors.reset();
+  for (int y = 0; y < GRID_Y; y++) {
+    for (int x = 0; x < GRID_X; x++) {
+      if (integrationField[y * GRID_X + x] ==
+          std::numeric_limits<int>::max()) {
+        continue;
+      }
+
+      // Neighbors may sit across a sector border
+      const int sectorMinX = std::max(x - 1, 0) / SECTOR_SIZE;
+      const int sectorMaxX = std::min(x + 1, GRID_X - 1) / SECTOR_SIZE;
+      const int sectorMinY = std::max(y - 1, 0) / SECTOR_SIZE;
+      const int sectorMaxY = std::min(y + 1, GRID_Y - 1) / SECTOR_SIZE;
+      for (int sy = sectorMinY; sy <= sectorMaxY; sy++) {
+        for (int sx = sectorMinX; sx <= sectorMaxX; sx++) {
+          order.dependentSectors.set(sy * SECTOR_X + sx);
+        }
+      }
+    }
+  }
+
+  order.sectorVersions = sCostField.sectorVersions;
+  order.buildStepIdx = sStepIdx;
+}
+
+// @returns true if a sector the field of 'order' depends on has changed.
+static bool FlowFieldOrderIsStale(const FlowFieldOrder &order) {
+  for (int sectorIdx = 0; sectorIdx < SECTOR_X * SECTOR_Y; sectorIdx++) {
+    if (order.dependentSectors.test(sectorIdx) &&
+        order.sectorVersions[sectorIdx] !=
+            sCostField.sectorVersions[sectorIdx]) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// @brief Rebuilds up to 'sFlowFieldRebuildsPerStep' stale flow fields, oldest
+// first.
+static void FlowFieldOrdersRefresh() {
+  sStaleFlowFieldOrders.clear();
+  for (uint32_t i = 0; i < sFlowFieldOrders.size(); i++) {
+    const FlowFieldOrder &order = sFlowFieldOrders[i];
+    if (order.targetIdx != -1 && FlowFieldOrderIsStale(order)) {
+      sStaleFlowFieldOrders.push_back(i);
+    }
+  }
+
+  const size_t rebuildCount = std::min<size_t>(sStaleFlowFieldOrders.size(),
+                                               sFlowFieldRebuildsPerStep);
+  std::partial_sort(sStaleFlowFieldOrders.begin(),
+                    sStaleFlowFieldOrders.begin() + rebuildCount,
+                    sStaleFlowFieldOrders.end(), [](uint32_t a, uint32_t b) {
+                      return sFlowFieldOrders[a].buildStepIdx <
+                             sFlowFieldOrders[b].buildStepIdx;
+                    });
+
+  for (size_t i = 0; i < rebuildCount; i++) {
+    FlowFieldOrderBuild(sFlowFieldOrders[sStaleFlowFieldOrders[i]]);
+  }
+}
+
+// @returns index of a flow field to 'target', reusing one if it exists.
+static uint32_t FlowFieldOrderAcquire(IVec2 target) {
+  const int targetIdx = target.y * GRID_X + target.x;
 
-void Init() {
+  uint32_t freeIdx = static_cast<uint32_t>(sFlowFieldOrders.size());
+  for (uint32_t i = 0; i < sFlowFieldOrders.size(); i++) {
+    if (sFlowFieldOrders[i].targetIdx == targetIdx) {
+      sFlowFieldOrders[i].unitCount++;
+      return i;
+    }
+
+    if (sFlowFieldOrders[i].targetIdx == -1 &&
+        freeIdx == sFlowFieldOrders.size()) {
+      freeIdx = i;
+    }
+  }
+
+  if (freeIdx == sFlowFieldOrders.size()) {
+    sFlowFieldOrders.emplace_back();
+  }
+
+  FlowFieldOrder &order = sFlowFieldOrders[freeIdx];
+  order.targetIdx = targetIdx;
+  order.unitCount = 1;
+  FlowFieldOrderBuild(order);
+
+  return freeIdx;
+}
+
+static uint32_t PathAcquire() {
+  if (!sFreePaths.empty()) {
+    uint32_t pathIdx = sFreePaths.back();
+    sFreePaths.pop_back();
+    return pathIdx;
+  }
+
+  sPaths.emplace_back();
+  return static_cast<uint32_t>(sPaths.size() - 1);
+}
+
+void Init(JobSystem *jobs) {
   sWorld = std::unique_ptr<cbz::ecs::IWorld>(cbz::ecs::InitWorld());
+  sUnits.clear();
+  sFreeUnits.clear();
+  sObstacles.clear();
+  sFreeObstacles.clear();
+
+  CostFieldInit(&sCostField);
+  CrowdDensityFieldInit(&sCrowdDensity);
+  StatusEffectPoolInit(&sStatusEffects);
+  ProjectilePoolInit(&sProjectiles);
+  GameEventQueueReset(&sEvents);
+  InfluenceMapInit(&sInfluenceMap);
+  sStepIdx = 0;
+  sBlockingPlaneVersions.clear();
+
   // --- Server Systems ---
 
-  // Movement
-  sWorld->system_for_each<Position, Unit, UnitMoveState>(
-      [](Position &position, [[maybe_unused]] Unit &_, UnitMoveState &moveState) {
+  SystemSchedulerInit(&sScheduler, jobs);
+  sWorld->system([](cbz::ecs::IWorld *world) {
+    SystemSchedulerRun(&sScheduler, world);
+  });
+
+  // Obstacles
+  SystemDesc obstacles;
+  obstacles.name = "Obstacles";
+  obstacles.access =
+      SystemReads<Position, Footprint, ObstaclePoolState>() |
+      SystemWrites<CostField>();
+  obstacles.flags = SYSTEM_FLAGS_NONE;
+  auto obstacleCache =
+      std::make_shared<QueryCache<Position, Footprint, ObstaclePoolState>>();
+  obstacles.prepare = [obstacleCache](cbz::ecs::IWorld *world) {
+    QueryCacheUpdate(obstacleCache.get(), world);
+  };
+  obstacles.fn = [obstacleCache](cbz::ecs::IWorld *world) {
+    // Despawned obstacles are left out and removed by the sync
+    CostFieldBeginSync(&sCostField);
+    QueryCacheForEach(
+        obstacleCache.get(), world,
+        [](cbz::ecs::Entity e, const Position &position,
+           const Footprint &footprint, const ObstaclePoolState &poolState) {
+          if (!poolState.isAlive) {
+            return;
+          }
+
+          CostFieldStampObstacle(&sCostField, e.getId(),
+                                 FootprintRect(footprint, position),
+                                 footprint.cost);
+        });
+    CostFieldEndSync(&sCostField);
+  };
+  SystemSchedulerAdd(&sScheduler, obstacles);
+
+  // Movement. Arriving releases paths and flow field orders.
+  SystemSchedulerAddForEach<Position, Unit, UnitMoveState>(
+      &sScheduler, "Movement",
+      [](Position &position, const Unit &unit, UnitMoveState &moveState) {
         if (!moveState.isMoving) {
           return;
         }
-        // TODO :find in flowfiled
-        // position.x += moveState.direction[0];
-        // position.y += moveState.direction[1];
-        // position.z += moveState.direction[2];
-        position.x += 5.0f * 0.001;
-      });
+
+        // Final approach to the formation slot
+        if (moveState.hasSlot && moveState.moveType != UNIT_MOVE_TYPE_SLOT) {
+          float dx = moveState.targetDst[0] - position.x;
+          float dz = moveState.targetDst[2] - position.z;
+          if (dx * dx + dz * dz <
+              sFormationApproachRadius * sFormationApproachRadius) {
+            MoveOrderArrive(moveState);
+          }
+        }
+
+        Vec2 direction = {0.0f, 0.0f};
+        float step = unit.movement_speed * sStepDeltaTime;
+        switch (moveState.moveType) {
+        case UNIT_MOVE_TYPE_PATH: {
+          const std::vector<IVec2> &path = sPaths[moveState.orderIdx];
+          Position waypoint = CellToWorld(path[moveState.waypointIdx]);
+
+          float dx = waypoint.x - position.x;
+          float dz = waypoint.z - position.z;
+          float distance = std::sqrt(dx * dx + dz * dz);
+
+          if (distance < sArrivalRadius) {
+            if (++moveState.waypointIdx >= path.size()) {
+              MoveOrderArrive(moveState);
+            }
+            return;
+          }
+
+          direction = {dx / distance, dz / distance};
+        } break;
+        case UNIT_MOVE_TYPE_FLOW_FIELD: {
+          const FlowFieldOrder &order = sFlowFieldOrders[moveState.orderIdx];
+          IVec2 cell = WorldToCell(position);
+          int cellIdx = cell.y * GRID_X + cell.x;
+
+          if (cellIdx == order.targetIdx) {
+            MoveOrderArrive(moveState);
+            return;
+          }
+
+          // Flow field 'y' points towards decreasing grid rows
+          Vec2 flow = order.flowField[cellIdx];
+          float length = std::sqrt(flow.x * flow.x + flow.y * flow.y);
+          if (length == 0.0f) {
+            return;
+          }
+
+          direction = {flow.x / length, -flow.y / length};
+        } break;
+        case UNIT_MOVE_TYPE_SLOT: {
+          float dx = moveState.targetDst[0] - position.x;
+          float dz = moveState.targetDst[2] - position.z;
+          float distance = std::sqrt(dx * dx + dz * dz);
+
+          if (distance < sArrivalRadius) {
+            ReleaseMoveOrder(moveState);
+            moveState.hasSlot = false;
+            return;
+          }
+
+          direction = {dx / distance, dz / distance};
+          step = std::min(step, distance);
+        } break;
+        case UNIT_MOVE_TYPE_NONE:
+          return;
+        }
+
+        position.x += direction.x * step;
+        position.z += direction.y * step;
+      },
+      SYSTEM_FLAGS_NONE, SystemWrites<FlowFieldOrder>());
+}
+
+IVec2 WorldToCell(Position position) {
+  int x = static_cast<int>(std::floor(position.x)) + GRID_X / 2;
+  int y = static_cast<int>(std::floor(position.z)) + GRID_Y / 2;
+
+  return {std::clamp(x, 0, GRID_X - 1), std::clamp(y, 0, GRID_Y - 1)};
+}
+
+Position CellToWorld(IVec2 cell) {
+  return {static_cast<float>(cell.x - GRID_X / 2) + 0.5f, 0.0f,
+          static_cast<float>(cell.y - GRID_Y / 2) + 0.5f};
+}
+
+// (dx, dy) of the 8 neighbors, straight first
+static constexpr int sNeighborOffsets[8][2] = {
+    {1, 0}, {-1, 0}, {0, -1}, {0, 1}, {1, -1}, {-1, -1}, {1, 1}, {-1, 1},
+};
+
+static inline bool IsInGrid(int x, int y) {
+  return x >= 0 && x < GRID_X && y >= 0 && y < GRID_Y;
 }
 
 void IntegrationFieldCreate(const int *costField, IVec2 center,
                             [[maybe_unused]] int searchRadius,
-                            int *integrationField) {
-  const glm::ivec2 gridDimensions(GRID_X, GRID_Y);
-  const int dstIdx = center.y * gridDimensions.x + center.x;
+                            int *integrationField, PathingStats *stats) {
+  const int dstIdx = center.y * GRID_X + center.x;
 
-  for (int i = 0; i < GRID_X * GRID_Y; i++) {
-    integrationField[i] = std::numeric_limits<int>::max();
-  }
+  std::fill_n(integrationField, GRID_X * GRID_Y,
+              std::numeric_limits<int>::max());
   integrationField[dstIdx] = 0;
 
-  std::vector<bool> seenList(GRID_X * GRID_Y);
-  std::fill(seenList.begin(), seenList.end(), false);
-
-  std::vector<int> openList(GRID_X * GRID_Y);
-  std::fill(openList.begin(), openList.end(), 0);
+  auto isPassable = [costField](int x, int y) {
+    return IsInGrid(x, y) && costField[y * GRID_X + x] < COST_IMPASSABLE;
+  };
 
-  int openListTail = 0;
-  int openListHead = 1;
+  // (cost, cellIdx). Entries are pushed only on strict improvement so each
+  // cell is settled by exactly one pop.
+  typedef std::pair<int, int> OpenNode;
+  std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>>
+      openList;
+  openList.push({0, dstIdx});
 
-  // BFS cost
-  openList[0] = dstIdx;
-  seenList[dstIdx] = true;
+  uint32_t cellsExpanded = 0;
+  uint32_t cellsVisited = 0;
+  while (!openList.empty()) {
+    const auto [cost, cellIdx] = openList.top();
+    openList.pop();
 
-  while (openListTail < openListHead) {
-    int cellIdx = openList[openListTail++];
-
-    int neighbors[8] = {
-        cellIdx + 1,                    // right
-        cellIdx - 1,                    // left
-        cellIdx - gridDimensions.x,     // top
-        cellIdx + gridDimensions.x,     // bottom
-        cellIdx - gridDimensions.x + 1, // top right
-        cellIdx - gridDimensions.x - 1, // top left
-        cellIdx + gridDimensions.x + 1, // bottom right
-        cellIdx + gridDimensions.x - 1, // bottom left
-    };
+    // Stale entry
+    if (cost > integrationField[cellIdx]) {
+      continue;
+    }
+    cellsExpanded++;
 
-    // Add newly seen neighbors to list
-    for (int directionIdx = 0; directionIdx < 8; directionIdx++) {
-      int neighborCellIdx = neighbors[directionIdx];
+    const int x = cellIdx % GRID_X;
+    const int y = cellIdx / GRID_X;
 
-      // Skip if out of bounds
-      if (neighborCellIdx < 0 ||
-          neighborCellIdx >= (gridDimensions.x * gridDimensions.y)) {
+    for (const auto &offset : sNeighborOffsets) {
+      const int nx = x + offset[0];
+      const int ny = y + offset[1];
+      if (!isPassable(nx, ny)) {
         continue;
       }
 
-      // Skip if out of bounds
-      if (neighborCellIdx >= gridDimensions.x * gridDimensions.y) {
-        continue;
-      }
+      const bool isDiagonal = offset[0] != 0 && offset[1] != 0;
 
-      // Skip seen neighbors
-      if (seenList[neighborCellIdx]) {
+      // No corner cutting
+      if (isDiagonal && (!isPassable(nx, y) || !isPassable(x, ny))) {
         continue;
       }
 
-      // Add neighbor to open list
-      openList[openListHead] = neighborCellIdx;
-      openListHead++;
-
-      // Mark neighbor cell as seen
-      seenList[neighborCellIdx] = true;
-
-      // Accumulate min costs
-      int newCost = integrationField[cellIdx] + costField[neighborCellIdx];
+      cellsVisited++;
+      const int neighborCellIdx = ny * GRID_X + nx;
+      const int newCost =
+          cost + costField[neighborCellIdx] *
+                     (isDiagonal ? STEP_COST_DIAGONAL : STEP_COST_STRAIGHT);
       if (newCost >= integrationField[neighborCellIdx]) {
         continue;
       }
 
-      // Debug Checks
-      if (integrationField[cellIdx] == std::numeric_limits<int>::max()) {
-        spdlog::error("Out of order access!");
-      }
-      if (integrationField[neighborCellIdx] != 0 &&
-          integrationField[neighborCellIdx] !=
-              std::numeric_limits<int>::max()) {
-        spdlog::error("neighbor {} {}", neighborCellIdx, dstIdx);
-      }
-
       integrationField[neighborCellIdx] = newCost;
-
-      if (newCost == 0 && neighborCellIdx != dstIdx) {
-        spdlog::error("{} has 0 cost despite not being {}", neighborCellIdx,
-                      dstIdx);
-      }
+      openList.push({newCost, neighborCellIdx});
     }
   }
+
+  if (stats) {
+    stats->cellsExpanded = cellsExpanded;
+    stats->cellsVisited = cellsVisited;
+  }
 }
 
-void FlowFieldCreate(const int *integrationField, IVec2 center,
+void FlowFieldCreate(const int *integrationField,
+                     [[maybe_unused]] IVec2 center,
                      [[maybe_unused]] int searchRadius, Vec2 *out) {
-  const glm::ivec2 gridDimensions(GRID_X, GRID_Y);
-  const int dstIdx = center.y * gridDimensions.x + center.x;
-
-  std::vector<int> costField(GRID_X * GRID_Y);
-  for (int i = 0; i < GRID_X * GRID_Y; i++) {
-    costField[i] = 1;
-  }
-  costField[dstIdx] = 0;
+  // Reachable cells only border unreachable ones across walls
+  auto isOpen = [integrationField](int x, int y) {
+    return IsInGrid(x, y) && integrationField[y * GRID_X + x] !=
+                                 std::numeric_limits<int>::max();
+  };
 
   for (int y = 0; y < GRID_Y; y++) {
     for (int x = 0; x < GRID_X; x++) {
-      int cellIdx = y * GRID_X + x;
-
-      int neighbors[8] = {
-          cellIdx + 1,                    // right
-          cellIdx - 1,                    // left
-          cellIdx - gridDimensions.x,     // top
-          cellIdx + gridDimensions.x,     // bottom
-          cellIdx - gridDimensions.x + 1, // top right
-          cellIdx - gridDimensions.x - 1, // top left
-          cellIdx + gridDimensions.x + 1, // bottom right
-          cellIdx + gridDimensions.x - 1, // bottom left
-      };
-
-      constexpr Vec2 neighborDirections[] = {
-          {1.0f, 0.0f},   // right
-          {-1.0f, 0.0f},  // left
-          {0.0f, 1.0f},   // top
-          {0.0f, -1.0f},  // bottom
-          {1.0f, 1.0f},   // top right
-          {-1.0f, 1.0f},  // top left
-          {1.0f, -1.0f},  // bottom right
-          {-1.0f, -1.0f}, // bottom left
-      };
-
-      // Checked neighbors for least
+      // Check neighbors for least
       Vec2 minCostNeighborDirection = {0.0f, 0.0f};
       int minCost = std::numeric_limits<int>::max();
-      for (int directionIdx = 0; directionIdx < 8; directionIdx++) {
-        int neighborCellIdx = neighbors[directionIdx];
-
-        // Skip if out of bounds left
-        if (neighborCellIdx < 0 ||
-            neighborCellIdx >= (gridDimensions.x * gridDimensions.y)) {
+      for (const auto &offset : sNeighborOffsets) {
+        const int nx = x + offset[0];
+        const int ny = y + offset[1];
+        if (!isOpen(nx, ny)) {
           continue;
         }
 
-        // Skip if out of bounds right
-        if (neighborCellIdx >= gridDimensions.x * gridDimensions.y) {
+        if (offset[0] != 0 && offset[1] != 0 &&
+            (!isOpen(nx, y) || !isOpen(x, ny))) {
           continue;
         }
 
-        if (integrationField[neighborCellIdx] < minCost) {
-          minCostNeighborDirection = neighborDirections[directionIdx];
-          minCost = integrationField[neighborCellIdx];
+        const int neighborCost = integrationField[ny * GRID_X + nx];
+        if (neighborCost < minCost) {
+          // Flow 'y' points up the grid (towards -y)
+          minCostNeighborDirection = {static_cast<float>(offset[0]),
+                                      static_cast<float>(-offset[1])};
+          minCost = neighborCost;
         }
       }
 
-      out[cellIdx] = minCostNeighborDirection;
+      out[y * GRID_X + x] = minCostNeighborDirection;
+    }
+  }
+}
+
+void CoarseGridSplat(float *grid, int gridX, int gridY, int cellSize,
+                     const float *positionsX, const float *positionsY,
+                     const float *weights, float weightScale, uint32_t count) {
+  const float invCellSize = 1.0f / static_cast<float>(cellSize);
+
+  for (uint32_t i = 0; i < count; i++) {
+    // Sample relative to coarse cell centers
+    float x = positionsX[i] * invCellSize - 0.5f;
+    float y = positionsY[i] * invCellSize - 0.5f;
+
+    int x0 = static_cast<int>(std::floor(x));
+    int y0 = static_cast<int>(std::floor(y));
+    float fx = x - x0;
+    float fy = y - y0;
+
+    const int xs[2] = {x0, x0 + 1};
+    const int ys[2] = {y0, y0 + 1};
+    const float wx[2] = {1.0f - fx, fx};
+    const float wy[2] = {1.0f - fy, fy};
+    const float weight = (weights ? weights[i] : 1.0f) * weightScale;
+
+    for (int j = 0; j < 2; j++) {
+      int cy = std::clamp(ys[j], 0, gridY - 1);
+      for (int k = 0; k < 2; k++) {
+        int cx = std::clamp(xs[k], 0, gridX - 1);
+        grid[cy * gridX + cx] += weight * wx[k] * wy[j];
+      }
     }
   }
 }
 
-unitId Spawn([[maybe_unused]] UnitAssetId _, Position dst) {
-  cbz::ecs::Entity e = sWorld->instantiate();
-  e.addComponent<Position>(dst);
-  e.addComponent<Rotation>();
-  e.addComponent<Scale>();
-  e.addComponent<Transform>();
-  e.addComponent<UnitMoveState>();
+obstacleId SpawnObstacle(Position position, Footprint footprint) {
+  obstacleId id;
+  if (!sFreeObstacles.empty()) {
+    id = sFreeObstacles.back();
+    sFreeObstacles.pop_back();
+  } else {
+    cbz::ecs::Entity e = sWorld->instantiate();
+    QueryAddComponent<Position>(sWorld.get(), e);
+    QueryAddComponent<Footprint>(sWorld.get(), e);
+    QueryAddComponent<ObstaclePoolState>(sWorld.get(), e);
 
-  unitId id = sUnits.size();
-  sUnits.push_back(e);
+    id = static_cast<obstacleId>(sObstacles.size());
+    sObstacles.push_back(e);
+  }
 
+  cbz::ecs::Entity e = sObstacles[id];
+  e.getComponent<Position>() = position;
+  e.getComponent<Footprint>() = footprint;
+  e.getComponent<ObstaclePoolState>().isAlive = true;
   return id;
 }
 
-void MoveTo(unitId unit, Position dst) {
-  UnitMoveState &moveState = sUnits[unit].getComponent<UnitMoveState>();
+void DespawnObstacle(obstacleId obstacle) {
+  if (obstacle >= sObstacles.size()) {
+    return;
+  }
+
+  ObstaclePoolState &poolState =
+      sObstacles[obstacle].getComponent<ObstaclePoolState>();
+  if (!poolState.isAlive) {
+    return;
+  }
+
+  poolState.isAlive = false;
+  sFreeObstacles.push_back(obstacle);
+}
+
+void ReserveUnits(uint32_t count) {
+  if (count <= sUnits.size()) {
+    return;
+  }
+
+  const unitId first = static_cast<unitId>(sUnits.size());
+  for (unitId id = first; id < count; id++) {
+    cbz::ecs::Entity e = sWorld->instantiate();
+    QueryAddComponent<Position>(sWorld.get(), e);
+    QueryAddComponent<Rotation>(sWorld.get(), e);
+    QueryAddComponent<Scale>(sWorld.get(), e);
+    QueryAddComponent<Transform>(sWorld.get(), e);
+    QueryAddComponent<UnitMoveState>(sWorld.get(), e);
+    QueryAddComponent<Unit>(sWorld.get(), e);
+    QueryAddComponent<UnitPoolState>(sWorld.get(), e);
+    QueryAddComponent<UnitTeam>(sWorld.get(), e);
+    QueryAddComponent<UnitAssetId>(sWorld.get(), e);
+    sUnits.push_back(e);
+  }
+
+  // Lowest ids are reused first
+  for (unitId id = count; id > first; id--) {
+    sFreeUnits.push_back(id - 1);
+  }
+}
+
+void SpawnBulk(UnitAssetId unitAssetId, const Position *dsts, uint32_t count,
+               unitId *outUnits) {
+  Unit unit = {};
+  if (unitAssetId.idx < sUnitTable.archetypes.size()) {
+    unit = UnitTableGet(&sUnitTable, unitAssetId);
+  } else {
+    spdlog::error("Spawn: unknown unit asset {}", unitAssetId.idx);
+    unitAssetId.idx = UNIT_ASSET_ID_INVALID;
+  }
+
+  if (sFreeUnits.size() < count) {
+    const uint32_t missing = count - static_cast<uint32_t>(sFreeUnits.size());
+    ReserveUnits(static_cast<uint32_t>(sUnits.size()) +
+                 std::max(missing, sUnitPoolGrowth));
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    const unitId id = sFreeUnits.back();
+    sFreeUnits.pop_back();
+
+    cbz::ecs::Entity e = sUnits[id];
+    e.getComponent<Position>() = dsts[i];
+    e.getComponent<Rotation>() = Rotation();
+    e.getComponent<Scale>() = Scale();
+    e.getComponent<UnitMoveState>() = UnitMoveState();
+    e.getComponent<Unit>() = unit;
+    e.getComponent<UnitAssetId>() = unitAssetId;
+    e.getComponent<UnitTeam>().idx = 0;
+    e.getComponent<UnitPoolState>().isAlive = true;
+
+    outUnits[i] = id;
+  }
+}
+
+unitId Spawn(UnitAssetId unitAssetId, Position dst) {
+  unitId id;
+  SpawnBulk(unitAssetId, &dst, 1, &id);
+  return id;
+}
+
+void Despawn(unitId unit) {
+  cbz::ecs::Entity e = sUnits[unit];
+  UnitPoolState &poolState = e.getComponent<UnitPoolState>();
+  if (!poolState.isAlive) {
+    return;
+  }
+
+  ReleaseMoveOrder(e.getComponent<UnitMoveState>());
+  StatusEffectRemoveAll(&sStatusEffects, unit);
+  for (BehaviorGroup *group : sBehaviorGroups) {
+    BehaviorGroupRemove(group, unit);
+  }
+
+  poolState.isAlive = false;
+  sFreeUnits.push_back(unit);
+}
+
+bool IsAlive(unitId unit) {
+  return unit < sUnits.size() &&
+         sUnits[unit].getComponent<UnitPoolState>().isAlive;
+}
+
+void SetTeam(unitId unit, uint32_t team) {
+  sUnits[unit].getComponent<UnitTeam>().idx = std::min(team, TEAM_COUNT - 1u);
+}
 
-  moveState.targetDst[0] = dst.x;
-  moveState.targetDst[1] = dst.y;
-  moveState.targetDst[2] = dst.z;
+uint32_t GetTeam(unitId unit) {
+  return sUnits[unit].getComponent<UnitTeam>().idx;
 }
 
-void Step() {}
+UnitAssetId GetUnitAssetId(unitId unit) {
+  return sUnits[unit].getComponent<UnitAssetId>();
+}
+
+void MoveTo(unitId unit, Position dst) { MoveGroupTo(&unit, 1, dst); }
+
+// @brief Fills 'sFormationTargets' with a slot for each unit in
+// 'sFormationUnits'.
+static void FormationSlotsAssign(Position dst, FormationType formation) {
+  const uint32_t count = static_cast<uint32_t>(sFormationUnits.size());
+
+  // Face the direction of travel from the group's center
+  Vec2 center = {0.0f, 0.0f};
+  for (const Vec2 &position : sFormationUnitPositions) {
+    center.x += position.x / static_cast<float>(count);
+    center.y += position.y / static_cast<float>(count);
+  }
+
+  Vec2 forward = {dst.x - center.x, dst.z - center.y};
+  const float length = std::sqrt(forward.x * forward.x + forward.y * forward.y);
+  forward = length > 0.0f ? Vec2{forward.x / length, forward.y / length}
+                          : Vec2{0.0f, 1.0f};
+
+  sFormationSlots.resize(count);
+  sFormationSlotPositions.resize(count);
+  sFormationSlotIdxs.resize(count);
+  FormationSlotsCreate(formation, count, sFormationSpacing,
+                       sFormationSlots.data());
+  FormationSlotsPlace(sFormationSlots.data(), count, {dst.x, dst.z}, forward,
+                      sFormationSlotPositions.data());
+  FormationAssign(sFormationSlots.data(), sFormationSlotPositions.data(),
+                  sFormationUnitPositions.data(), count, forward,
+                  sFormationSlotIdxs.data());
+
+  // Slots off the grid or inside walls fall back to 'dst'
+  sFormationTargets.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Vec2 slot = sFormationSlotPositions[sFormationSlotIdxs[i]];
+    const int x = static_cast<int>(std::floor(slot.x)) + GRID_X / 2;
+    const int y = static_cast<int>(std::floor(slot.y)) + GRID_Y / 2;
+    if (x < 0 || x >= GRID_X || y < 0 || y >= GRID_Y ||
+        sCostField.costs[y * GRID_X + x] >= COST_IMPASSABLE) {
+      slot = {dst.x, dst.z};
+    }
+
+    sFormationTargets[i] = slot;
+  }
+}
+
+void MoveGroupTo(const unitId *units, uint32_t count, Position dst,
+                 FormationType formation) {
+  const IVec2 target = WorldToCell(dst);
+  const int targetIdx = target.y * GRID_X + target.x;
+
+  sFormationUnits.clear();
+  sFormationUnitPositions.clear();
+  for (uint32_t i = 0; i < count; i++) {
+    if (IsAlive(units[i])) {
+      const Position &position = sUnits[units[i]].getComponent<Position>();
+      sFormationUnits.push_back(units[i]);
+      sFormationUnitPositions.push_back({position.x, position.z});
+    }
+  }
+
+  // Estimate per unit A* work against one shared flow field
+  bool hasFlowField = false;
+  for (const FlowFieldOrder &order : sFlowFieldOrders) {
+    hasFlowField |= order.targetIdx == targetIdx;
+  }
+
+  int64_t pathCost = 0;
+  for (unitId unit : sFormationUnits) {
+    IVec2 cell = WorldToCell(sUnits[unit].getComponent<Position>());
+    int64_t distance =
+        std::max(std::abs(cell.x - target.x), std::abs(cell.y - target.y)) + 1;
+    pathCost += sPathCellsPerDistanceSq * distance * distance;
+  }
+
+  const bool usePaths = !hasFlowField && pathCost < sFlowFieldCells;
+
+  const bool useSlots =
+      formation != FORMATION_TYPE_NONE && sFormationUnits.size() > 1;
+  if (useSlots) {
+    FormationSlotsAssign(dst, formation);
+  }
+
+  // Units share the route to 'target' and split up to their slots near it
+  IVec2 waypoints[PATH_MAX_WAYPOINTS];
+  for (uint32_t i = 0; i < sFormationUnits.size(); i++) {
+    cbz::ecs::Entity e = sUnits[sFormationUnits[i]];
+    UnitMoveState &moveState = e.getComponent<UnitMoveState>();
+    ReleaseMoveOrder(moveState);
+
+    moveState.targetDst[0] = useSlots ? sFormationTargets[i].x : dst.x;
+    moveState.targetDst[1] = dst.y;
+    moveState.targetDst[2] = useSlots ? sFormationTargets[i].y : dst.z;
+    moveState.hasSlot = useSlots;
+
+    // Already there, no route needed
+    const IVec2 start = WorldToCell(e.getComponent<Position>());
+    if (start.x == target.x && start.y == target.y) {
+      MoveOrderArrive(moveState);
+      continue;
+    }
+
+    uint32_t waypointCount = 0;
+    if (usePaths) {
+      waypointCount = PathCreate(sCostField.costs.data(), start, target,
+                                 waypoints, PATH_MAX_WAYPOINTS);
+    }
+
+    if (waypointCount > 0) {
+      moveState.orderIdx = PathAcquire();
+      sPaths[moveState.orderIdx].assign(waypoints, waypoints + waypointCount);
+      moveState.waypointIdx = 0;
+      moveState.moveType = UNIT_MOVE_TYPE_PATH;
+    } else {
+      // Also taken when A* finds no path or one longer than
+      // 'PATH_MAX_WAYPOINTS'. Units cut off from 'target' hold the order and
+      // start moving once the cost field opens a way.
+      moveState.orderIdx = FlowFieldOrderAcquire(target);
+      moveState.moveType = UNIT_MOVE_TYPE_FLOW_FIELD;
+    }
+
+    moveState.isMoving = true;
+  }
+}
+
+CostField *GetCostField() { return &sCostField; }
+
+StatusEffectPool *GetStatusEffects() { return &sStatusEffects; }
+
+ProjectilePool *GetProjectiles() { return &sProjectiles; }
+
+const UnitGrid *GetUnitGrid() { return &sUnitGrid; }
+
+const std::vector<GameEvent> &GetGameEvents() { return sEvents.events; }
+
+const InfluenceMap *GetInfluenceMap() { return &sInfluenceMap; }
+
+void RegisterBehaviorGroup(BehaviorGroup *group) {
+  if (std::find(sBehaviorGroups.begin(), sBehaviorGroups.end(), group) ==
+      sBehaviorGroups.end()) {
+    sBehaviorGroups.push_back(group);
+  }
+}
+
+void UnregisterBehaviorGroup(BehaviorGroup *group) {
+  sBehaviorGroups.erase(
+      std::remove(sBehaviorGroups.begin(), sBehaviorGroups.end(), group),
+      sBehaviorGroups.end());
+}
+
+UnitTable *GetUnitTable() { return &sUnitTable; }
+
+// @brief Applies merged damage events from 'firstEventIdx' on and merges the
+// resulting deaths.
+static void DamageEventsApply(size_t firstEventIdx) {
+  const size_t eventCount = sEvents.events.size();
+  for (size_t i = firstEventIdx; i < eventCount; i++) {
+    const GameEvent &event = sEvents.events[i];
+    if (event.type != GAME_EVENT_TYPE_DAMAGE || event.amount <= 0.0f ||
+        !IsAlive(event.target)) {
+      continue;
+    }
+
+    Unit &stats = sUnits[event.target].getComponent<Unit>();
+    stats.health -= event.amount;
+    if (stats.health > 0.0f) {
+      continue;
+    }
+
+    GameEvent death = {};
+    death.type = GAME_EVENT_TYPE_UNIT_DEATH;
+    death.source = event.source;
+    death.target = event.target;
+    death.point = sUnits[event.target].getComponent<Position>();
+    death.orderKey =
+        GameEventOrderKey(STEP_PHASE_DEATHS, static_cast<uint32_t>(i));
+    GameEventAppend(&sEvents, death);
+
+    Despawn(event.target);
+  }
+
+  GameEventQueueMerge(&sEvents);
+}
+
+// @brief Updates the influence layers of the teams due this step. Teams are
+// spread over 'INFLUENCE_UPDATE_INTERVAL' steps.
+// @note Reads alive units from the unit grid, so run after 'UnitGridRebuild'.
+static void InfluenceUpdate() {
+  const uint32_t unitCount = static_cast<uint32_t>(sUnitGrid.units.size());
+
+  for (uint32_t team = sStepIdx % INFLUENCE_UPDATE_INTERVAL; team < TEAM_COUNT;
+       team += INFLUENCE_UPDATE_INTERVAL) {
+    sInfluencePositionsX.clear();
+    sInfluencePositionsY.clear();
+    sInfluenceStrengths.clear();
+
+    for (uint32_t i = 0; i < unitCount; i++) {
+      if (sUnitGrid.teams[i] != team) {
+        continue;
+      }
+
+      sInfluencePositionsX.push_back(sUnitGrid.positionsX[i]);
+      sInfluencePositionsY.push_back(sUnitGrid.positionsY[i]);
+      sInfluenceStrengths.push_back(
+          sUnits[sUnitGrid.units[i]].getComponent<Unit>().damage);
+    }
+
+    InfluenceLayerUpdate(&sInfluenceMap, team, sInfluencePositionsX.data(),
+                         sInfluencePositionsY.data(),
+                         sInfluenceStrengths.data(),
+                         static_cast<uint32_t>(sInfluenceStrengths.size()));
+  }
+}
+
+static void UnitGridRebuild() {
+  sUnitGridUnits.clear();
+  sUnitGridPositions.clear();
+  sUnitGridTeams.clear();
+
+  for (unitId id = 0; id < sUnits.size(); id++) {
+    cbz::ecs::Entity e = sUnits[id];
+    if (!e.getComponent<UnitPoolState>().isAlive) {
+      continue;
+    }
+
+    const Position &position = e.getComponent<Position>();
+    sUnitGridUnits.push_back(id);
+    sUnitGridPositions.push_back(
+        {position.x + GRID_X / 2, position.z + GRID_Y / 2});
+    sUnitGridTeams.push_back(e.getComponent<UnitTeam>().idx);
+  }
+
+  UnitGridBuild(&sUnitGrid, sUnitGridUnits.data(), sUnitGridPositions.data(),
+                sUnitGridTeams.data(),
+                static_cast<uint32_t>(sUnitGridUnits.size()));
+}
+
+void Step() {
+  // Rebuild flow fields whose cost field sectors changed
+  FlowFieldOrdersRefresh();
+
+  GameEventQueueReset(&sEvents);
+
+  // Status effects
+  sStatusEffectEvents.clear();
+  StatusEffectPoolStep(&sStatusEffects, &sStatusEffectEvents);
+  for (uint32_t i = 0; i < sStatusEffectEvents.size(); i++) {
+    const StatusEffectEvent &effect = sStatusEffectEvents[i];
+
+    GameEvent event = {};
+    event.type = effect.expired ? GAME_EVENT_TYPE_STATUS_EXPIRED
+                                : GAME_EVENT_TYPE_DAMAGE;
+    event.source = UNIT_ID_INVALID;
+    event.target = effect.unit;
+    event.data = effect.type;
+    event.amount = effect.damage;
+    event.orderKey = GameEventOrderKey(STEP_PHASE_STATUS_EFFECTS, i);
+    GameEventAppend(&sEvents, event);
+  }
+
+  size_t firstEventIdx = sEvents.events.size();
+  GameEventQueueMerge(&sEvents);
+  DamageEventsApply(firstEventIdx);
+
+  // Blocking cells follow the cost field
+  if (sBlockingPlaneVersions != sCostField.sectorVersions) {
+    BlockingBitplaneCreate(sCostField.costs.data(), &sBlockingPlane);
+    sBlockingPlaneVersions = sCostField.sectorVersions;
+  }
+
+  UnitGridRebuild();
+
+  // Crowds raise pathing costs. Flow fields through restamped sectors are
+  // rebuilt next step.
+  CrowdDensitySplat(&sCrowdDensity, sUnitGrid.positionsX.data(),
+                    sUnitGrid.positionsY.data(),
+                    static_cast<uint32_t>(sUnitGrid.units.size()));
+  CrowdDensityApply(&sCrowdDensity, &sCostField);
+
+  // Projectiles
+  sProjectileHits.clear();
+  ProjectilePoolStep(&sProjectiles, sStepDeltaTime, &sBlockingPlane,
+                     &sUnitGrid, &sProjectileHits);
+  for (uint32_t i = 0; i < sProjectileHits.size(); i++) {
+    const ProjectileHit &hit = sProjectileHits[i];
+
+    GameEvent event = {};
+    event.type = GAME_EVENT_TYPE_PROJECTILE_IMPACT;
+    event.source = hit.owner;
+    event.target = hit.target;
+    event.amount = hit.damage;
+    event.point = hit.point;
+    event.orderKey = GameEventOrderKey(STEP_PHASE_PROJECTILES, i);
+    GameEventAppend(&sEvents, event);
+
+    if (hit.target != UNIT_ID_INVALID) {
+      event.type = GAME_EVENT_TYPE_DAMAGE;
+      GameEventAppend(&sEvents, event);
+    }
+  }
+
+  firstEventIdx = sEvents.events.size();
+  GameEventQueueMerge(&sEvents);
+  DamageEventsApply(firstEventIdx);
+
+  InfluenceUpdate();
+
+  for (BehaviorGroup *group : sBehaviorGroups) {
+    BehaviorGroupTick(group, sStepIdx);
+  }
+
+  sWorld->step(sStepDeltaTime);
+  sStepIdx++;
+}
 
-void Shutdown() {}
+void Shutdown() { SystemSchedulerShutdown(&sScheduler); }
 
 }; // namespace rts
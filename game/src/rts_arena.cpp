@@ -0,0 +1,107 @@
+#include "rts/rts_arena.h"
+
+#include "spdlog/spdlog.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace rts {
+
+// @brief malloc that aborts instead of returning null.
+static void *ArenaMalloc(size_t size) {
+  void *ptr = std::malloc(size);
+  if (!ptr && size > 0) {
+    spdlog::critical("FrameArena: failed to allocate {} bytes", size);
+    std::abort();
+  }
+
+  return ptr;
+}
+
+static void *AlignUp(void *ptr, size_t alignment) {
+  const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  return reinterpret_cast<void *>((address + alignment - 1) &
+                                  ~(uintptr_t(alignment) - 1));
+}
+
+static void LinearArenaReset(LinearArena *arena) {
+  for (void *block : arena->overflowBlocks) {
+    std::free(block);
+  }
+  arena->overflowBlocks.clear();
+
+  // Grow so the next frame fits in one block
+  if (arena->overflowBytes > 0) {
+    const size_t capacity = arena->capacity + arena->overflowBytes;
+    std::free(arena->block);
+    arena->block = static_cast<uint8_t *>(ArenaMalloc(capacity));
+    arena->capacity = capacity;
+    arena->overflowBytes = 0;
+  }
+
+  arena->offset = 0;
+}
+
+static void *LinearArenaAlloc(LinearArena *arena, size_t size,
+                              size_t alignment) {
+  uint8_t *ptr = static_cast<uint8_t *>(
+      AlignUp(arena->block + arena->offset, alignment));
+
+  if (ptr + size <= arena->block + arena->capacity) {
+    arena->offset = static_cast<size_t>(ptr - arena->block) + size;
+    return ptr;
+  }
+
+  void *block = ArenaMalloc(size + alignment);
+  arena->overflowBlocks.push_back(block);
+  arena->overflowBytes += size + alignment;
+  return AlignUp(block, alignment);
+}
+
+void FrameArenaInit(FrameArena *arena, size_t threadCapacity) {
+  FrameArenaShutdown(arena);
+  arena->threadCapacity = threadCapacity;
+}
+
+void FrameArenaShutdown(FrameArena *arena) {
+  for (LinearArena &threadArena : arena->threadArenas) {
+    for (void *block : threadArena.overflowBlocks) {
+      std::free(block);
+    }
+
+    std::free(threadArena.block);
+    threadArena = {};
+  }
+}
+
+void FrameArenaReset(FrameArena *arena) {
+  for (LinearArena &threadArena : arena->threadArenas) {
+    LinearArenaReset(&threadArena);
+  }
+}
+
+void *FrameArenaAlloc(FrameArena *arena, size_t size, size_t alignment) {
+  LinearArena *threadArena = &arena->threadArenas[FrameArenaThreadIndex()];
+
+  // Reserved lazily so threads that never allocate cost nothing
+  if (!threadArena->block) {
+    threadArena->block =
+        static_cast<uint8_t *>(ArenaMalloc(arena->threadCapacity));
+    threadArena->capacity = arena->threadCapacity;
+  }
+
+  return LinearArenaAlloc(threadArena, size, alignment);
+}
+
+uint32_t FrameArenaThreadIndex() {
+  const uint32_t threadIdx = JobSystemThreadIndex();
+  if (threadIdx >= FRAME_ARENA_MAX_THREADS) {
+    spdlog::critical("FrameArena: allocating from a thread outside the job "
+                     "system");
+    std::abort();
+  }
+
+  return threadIdx;
+}
+
+}; // namespace rts
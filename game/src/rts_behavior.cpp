@@ -0,0 +1,231 @@
+#include "rts/rts_behavior.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace rts {
+
+// --- Building ---
+void BehaviorTreeInit(BehaviorTree *tree) {
+  tree->nodes.clear();
+  tree->maxDepth = 0;
+  tree->openNodes.clear();
+}
+
+void BehaviorTreeBegin(BehaviorTree *tree, BehaviorNodeType type,
+                       BehaviorScoreFn score) {
+  tree->openNodes.push_back(static_cast<uint32_t>(tree->nodes.size()));
+  tree->nodes.push_back({type, 1, nullptr, score});
+  tree->maxDepth = std::max(tree->maxDepth,
+                            static_cast<uint32_t>(tree->openNodes.size()));
+}
+
+void BehaviorTreeEnd(BehaviorTree *tree) {
+  const uint32_t nodeIdx = tree->openNodes.back();
+  tree->openNodes.pop_back();
+  tree->nodes[nodeIdx].subtreeSize =
+      static_cast<uint32_t>(tree->nodes.size()) - nodeIdx;
+}
+
+void BehaviorTreeLeaf(BehaviorTree *tree, BehaviorLeafFn leaf,
+                      BehaviorScoreFn score) {
+  tree->nodes.push_back({BEHAVIOR_NODE_TYPE_LEAF, 1, leaf, score});
+  tree->maxDepth = std::max(tree->maxDepth,
+                            static_cast<uint32_t>(tree->openNodes.size() + 1));
+}
+
+// --- Groups ---
+void BehaviorGroupInit(BehaviorGroup *group, const BehaviorTree *tree,
+                       uint32_t floatKeyCount, uint32_t intKeyCount,
+                       uint32_t tickInterval) {
+  group->tree = tree;
+  group->tickInterval = std::max(tickInterval, 1u);
+  group->units.clear();
+  group->agentLookup.clear();
+  group->floatKeys.assign(floatKeyCount, {});
+  group->intKeys.assign(intKeyCount, {});
+  group->statuses.clear();
+  group->userData = nullptr;
+}
+
+uint32_t BehaviorGroupAdd(BehaviorGroup *group, unitId unit) {
+  auto it = group->agentLookup.find(unit);
+  if (it != group->agentLookup.end()) {
+    return it->second;
+  }
+
+  const uint32_t agentIdx = static_cast<uint32_t>(group->units.size());
+  group->units.push_back(unit);
+  group->agentLookup[unit] = agentIdx;
+
+  for (std::vector<float> &column : group->floatKeys) {
+    column.push_back(0.0f);
+  }
+  for (std::vector<int32_t> &column : group->intKeys) {
+    column.push_back(0);
+  }
+  group->statuses.push_back(BEHAVIOR_STATUS_SUCCESS);
+
+  return agentIdx;
+}
+
+void BehaviorGroupRemove(BehaviorGroup *group, unitId unit) {
+  auto it = group->agentLookup.find(unit);
+  if (it == group->agentLookup.end()) {
+    return;
+  }
+
+  const uint32_t agentIdx = it->second;
+  const uint32_t lastIdx = static_cast<uint32_t>(group->units.size() - 1);
+  group->agentLookup.erase(it);
+
+  if (agentIdx != lastIdx) {
+    group->units[agentIdx] = group->units[lastIdx];
+    group->agentLookup[group->units[agentIdx]] = agentIdx;
+
+    for (std::vector<float> &column : group->floatKeys) {
+      column[agentIdx] = column[lastIdx];
+    }
+    for (std::vector<int32_t> &column : group->intKeys) {
+      column[agentIdx] = column[lastIdx];
+    }
+    group->statuses[agentIdx] = group->statuses[lastIdx];
+  }
+
+  group->units.pop_back();
+  for (std::vector<float> &column : group->floatKeys) {
+    column.pop_back();
+  }
+  for (std::vector<int32_t> &column : group->intKeys) {
+    column.pop_back();
+  }
+  group->statuses.pop_back();
+}
+
+// @brief Ticks node 'nodeIdx' for 'agents'. Each level takes at most 2 *
+// 'count' entries of 'scratch' and 'scores'.
+static void NodeTick(BehaviorGroup *group, uint32_t nodeIdx,
+                     const uint32_t *agents, uint32_t count, uint32_t *scratch,
+                     float *scores) {
+  const BehaviorNode *nodes = group->tree->nodes.data();
+  const BehaviorNode &node = nodes[nodeIdx];
+  const uint32_t endIdx = nodeIdx + node.subtreeSize;
+  BehaviorStatus *statuses = group->statuses.data();
+
+  switch (node.type) {
+  case BEHAVIOR_NODE_TYPE_LEAF: {
+    if (node.leaf) {
+      node.leaf(group, agents, count, statuses);
+    } else {
+      for (uint32_t i = 0; i < count; i++) {
+        statuses[agents[i]] = BEHAVIOR_STATUS_SUCCESS;
+      }
+    }
+  } break;
+  case BEHAVIOR_NODE_TYPE_SEQUENCE:
+  case BEHAVIOR_NODE_TYPE_SELECTOR: {
+    // Status that moves on to the next child
+    const BehaviorStatus passStatus = node.type == BEHAVIOR_NODE_TYPE_SEQUENCE
+                                          ? BEHAVIOR_STATUS_SUCCESS
+                                          : BEHAVIOR_STATUS_FAILURE;
+
+    uint32_t *active = scratch;
+    uint32_t activeCount = count;
+    for (uint32_t i = 0; i < count; i++) {
+      active[i] = agents[i];
+      statuses[agents[i]] = passStatus;
+    }
+
+    // Agents that stopped keep the status of the child they stopped at
+    for (uint32_t childIdx = nodeIdx + 1; childIdx < endIdx && activeCount > 0;
+         childIdx += nodes[childIdx].subtreeSize) {
+      NodeTick(group, childIdx, active, activeCount, scratch + count,
+               scores + 2 * count);
+
+      uint32_t passCount = 0;
+      for (uint32_t i = 0; i < activeCount; i++) {
+        if (statuses[active[i]] == passStatus) {
+          active[passCount++] = active[i];
+        }
+      }
+      activeCount = passCount;
+    }
+  } break;
+  case BEHAVIOR_NODE_TYPE_UTILITY: {
+    uint32_t *bestChildren = scratch;
+    uint32_t *subset = scratch + count;
+    float *bestScores = scores;
+    float *childScores = scores + count;
+
+    for (uint32_t i = 0; i < count; i++) {
+      bestChildren[i] = endIdx;
+      bestScores[i] = -std::numeric_limits<float>::infinity();
+      statuses[agents[i]] = BEHAVIOR_STATUS_FAILURE;
+    }
+
+    for (uint32_t childIdx = nodeIdx + 1; childIdx < endIdx;
+         childIdx += nodes[childIdx].subtreeSize) {
+      if (nodes[childIdx].score) {
+        nodes[childIdx].score(group, agents, count, childScores);
+      } else {
+        std::fill(childScores, childScores + count, 0.0f);
+      }
+
+      for (uint32_t i = 0; i < count; i++) {
+        if (childScores[i] > bestScores[i]) {
+          bestScores[i] = childScores[i];
+          bestChildren[i] = childIdx;
+        }
+      }
+    }
+
+    // Tick each child once with every agent that picked it
+    for (uint32_t childIdx = nodeIdx + 1; childIdx < endIdx;
+         childIdx += nodes[childIdx].subtreeSize) {
+      uint32_t subsetCount = 0;
+      for (uint32_t i = 0; i < count; i++) {
+        if (bestChildren[i] == childIdx) {
+          subset[subsetCount++] = agents[i];
+        }
+      }
+
+      if (subsetCount > 0) {
+        NodeTick(group, childIdx, subset, subsetCount, scratch + 2 * count,
+                 scores + 2 * count);
+      }
+    }
+  } break;
+  case BEHAVIOR_NODE_TYPE_COUNT:
+    break;
+  }
+}
+
+void BehaviorGroupTick(BehaviorGroup *group, uint64_t stepIdx) {
+  if (group->tree->nodes.empty() || group->units.empty()) {
+    return;
+  }
+
+  const uint32_t agentCount = static_cast<uint32_t>(group->units.size());
+  const uint32_t levelCount = group->tree->maxDepth + 1;
+  group->scratch.resize(agentCount + 2 * agentCount * levelCount);
+  group->scoreScratch.resize(2 * agentCount * levelCount);
+
+  // Round robin slice due this step
+  const uint32_t phase =
+      static_cast<uint32_t>(stepIdx % group->tickInterval);
+  uint32_t *due = group->scratch.data();
+  uint32_t dueCount = 0;
+  for (uint32_t agentIdx = phase; agentIdx < agentCount;
+       agentIdx += group->tickInterval) {
+    due[dueCount++] = agentIdx;
+  }
+
+  if (dueCount == 0) {
+    return;
+  }
+
+  NodeTick(group, 0, due, dueCount, due + agentCount,
+           group->scoreScratch.data());
+}
+
+}; // namespace rts
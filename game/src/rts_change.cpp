@@ -0,0 +1,39 @@
+#include "rts/rts_change.h"
+
+#include <algorithm>
+
+namespace rts {
+
+void ChangeTicksMark(ChangeTicks *changes, cbz::ecs::EntityId eId,
+                     uint64_t tick) {
+  if (eId >= changes->entityTicks.size()) {
+    changes->entityTicks.resize(eId + 1, 0);
+    changes->blockTicks.resize(eId / CHANGE_BLOCK_SIZE + 1, 0);
+  }
+
+  changes->entityTicks[eId] = tick;
+
+  uint64_t &blockTick = changes->blockTicks[eId / CHANGE_BLOCK_SIZE];
+  blockTick = std::max(blockTick, tick);
+}
+
+bool ChangeTicksBlockChangedSince(const ChangeTicks *changes,
+                                  uint32_t blockIdx, uint64_t tick) {
+  return blockIdx < changes->blockTicks.size() &&
+         changes->blockTicks[blockIdx] >= tick;
+}
+
+bool ChangeTicksChangedSince(const ChangeTicks *changes,
+                             cbz::ecs::EntityId eId, uint64_t tick) {
+  if (eId >= changes->entityTicks.size()) {
+    return false;
+  }
+
+  if (changes->blockTicks[eId / CHANGE_BLOCK_SIZE] < tick) {
+    return false;
+  }
+
+  return changes->entityTicks[eId] >= tick;
+}
+
+}; // namespace rts
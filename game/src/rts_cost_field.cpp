@@ -0,0 +1,191 @@
+#include "rts/rts_cost_field.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rts {
+
+int CellTypeCost(CellType type) {
+  switch (type) {
+  case CELL_TYPE_GROUND:
+    return 1;
+  case CELL_TYPE_MUD:
+    return 4;
+  case CELL_TYPE_NONE:
+  case CELL_TYPE_WATER:
+  case CELL_TYPE_COUNT:
+    break;
+  }
+
+  return COST_IMPASSABLE;
+}
+
+static inline void SectorTouch(CostField *field, int x, int y) {
+  field->sectorVersions[(y / SECTOR_SIZE) * SECTOR_X + (x / SECTOR_SIZE)]++;
+}
+
+static inline void CellRestamp(CostField *field, int cellIdx) {
+  const int baseCost =
+      CellTypeCost(field->terrain[cellIdx]) + field->obstacleCosts[cellIdx];
+  if (baseCost >= COST_IMPASSABLE) {
+    field->costs[cellIdx] = COST_IMPASSABLE;
+    return;
+  }
+
+  field->costs[cellIdx] =
+      std::min(baseCost + field->densityCosts[cellIdx], COST_IMPASSABLE - 1);
+}
+
+void CostFieldTouchSectors(CostField *field, CellRect rect) {
+  const int sectorMinX = rect.min.x / SECTOR_SIZE;
+  const int sectorMaxX = rect.max.x / SECTOR_SIZE;
+  const int sectorMinY = rect.min.y / SECTOR_SIZE;
+  const int sectorMaxY = rect.max.y / SECTOR_SIZE;
+  for (int sy = sectorMinY; sy <= sectorMaxY; sy++) {
+    for (int sx = sectorMinX; sx <= sectorMaxX; sx++) {
+      SectorTouch(field, sx * SECTOR_SIZE, sy * SECTOR_SIZE);
+    }
+  }
+}
+
+// @brief Adds 'cost' to every cell in 'rect' and bumps each touched sector
+// once.
+static void RectStamp(CostField *field, CellRect rect, int cost) {
+  for (int y = rect.min.y; y <= rect.max.y; y++) {
+    for (int x = rect.min.x; x <= rect.max.x; x++) {
+      int cellIdx = y * GRID_X + x;
+      field->obstacleCosts[cellIdx] += cost;
+      CellRestamp(field, cellIdx);
+    }
+  }
+
+  CostFieldTouchSectors(field, rect);
+}
+
+void CostFieldInit(CostField *field) {
+  field->terrain.assign(GRID_X * GRID_Y, CELL_TYPE_GROUND);
+  field->obstacleCosts.assign(GRID_X * GRID_Y, 0);
+  field->densityCosts.assign(GRID_X * GRID_Y, 0);
+  field->costs.assign(GRID_X * GRID_Y, CellTypeCost(CELL_TYPE_GROUND));
+  field->sectorVersions.assign(SECTOR_X * SECTOR_Y, 1);
+  field->obstacles.clear();
+  field->syncGeneration = 0;
+}
+
+void CostFieldSetTerrain(CostField *field, IVec2 cell, CellType type) {
+  const int cellIdx = cell.y * GRID_X + cell.x;
+  if (field->terrain[cellIdx] == type) {
+    return;
+  }
+
+  field->terrain[cellIdx] = type;
+  CellRestamp(field, cellIdx);
+  SectorTouch(field, cell.x, cell.y);
+}
+
+void CostFieldFillTerrain(CostField *field, CellRect rect, CellType type) {
+  bool isChanged = false;
+  for (int y = rect.min.y; y <= rect.max.y; y++) {
+    for (int x = rect.min.x; x <= rect.max.x; x++) {
+      int cellIdx = y * GRID_X + x;
+      if (field->terrain[cellIdx] == type) {
+        continue;
+      }
+
+      field->terrain[cellIdx] = type;
+      CellRestamp(field, cellIdx);
+      isChanged = true;
+    }
+  }
+
+  if (isChanged) {
+    CostFieldTouchSectors(field, rect);
+  }
+}
+
+CellRect FootprintRect(const Footprint &footprint, Position position) {
+  IVec2 center = WorldToCell(position);
+
+  CellRect rect;
+  rect.min = {center.x - (footprint.width - 1) / 2,
+              center.y - (footprint.height - 1) / 2};
+  rect.max = {rect.min.x + footprint.width - 1,
+              rect.min.y + footprint.height - 1};
+
+  rect.min = {std::clamp(rect.min.x, 0, GRID_X - 1),
+              std::clamp(rect.min.y, 0, GRID_Y - 1)};
+  rect.max = {std::clamp(rect.max.x, 0, GRID_X - 1),
+              std::clamp(rect.max.y, 0, GRID_Y - 1)};
+  return rect;
+}
+
+void CostFieldStampObstacle(CostField *field, uint32_t obstacleId,
+                            CellRect rect, int cost) {
+  auto it = field->obstacles.find(obstacleId);
+
+  if (it != field->obstacles.end()) {
+    CostField::ObstacleStamp &stamp = it->second;
+    stamp.syncGeneration = field->syncGeneration;
+
+    // Unchanged
+    if (stamp.cost == cost && stamp.rect.min.x == rect.min.x &&
+        stamp.rect.min.y == rect.min.y && stamp.rect.max.x == rect.max.x &&
+        stamp.rect.max.y == rect.max.y) {
+      return;
+    }
+
+    // Moved
+    RectStamp(field, stamp.rect, -stamp.cost);
+    RectStamp(field, rect, cost);
+    stamp.rect = rect;
+    stamp.cost = cost;
+    return;
+  }
+
+  RectStamp(field, rect, cost);
+  field->obstacles[obstacleId] = {rect, cost, field->syncGeneration};
+}
+
+void CostFieldRemoveObstacle(CostField *field, uint32_t obstacleId) {
+  auto it = field->obstacles.find(obstacleId);
+  if (it == field->obstacles.end()) {
+    return;
+  }
+
+  RectStamp(field, it->second.rect, -it->second.cost);
+  field->obstacles.erase(it);
+}
+
+bool CostFieldSetDensity(CostField *field, CellRect rect, int cost) {
+  bool isChanged = false;
+  for (int y = rect.min.y; y <= rect.max.y; y++) {
+    for (int x = rect.min.x; x <= rect.max.x; x++) {
+      int cellIdx = y * GRID_X + x;
+      if (field->densityCosts[cellIdx] == cost) {
+        continue;
+      }
+
+      field->densityCosts[cellIdx] = cost;
+      CellRestamp(field, cellIdx);
+      isChanged = true;
+    }
+  }
+
+  return isChanged;
+}
+
+void CostFieldBeginSync(CostField *field) { field->syncGeneration++; }
+
+void CostFieldEndSync(CostField *field) {
+  for (auto it = field->obstacles.begin(); it != field->obstacles.end();) {
+    if (it->second.syncGeneration == field->syncGeneration) {
+      ++it;
+      continue;
+    }
+
+    RectStamp(field, it->second.rect, -it->second.cost);
+    it = field->obstacles.erase(it);
+  }
+}
+
+}; // namespace rts
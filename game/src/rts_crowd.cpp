@@ -0,0 +1,89 @@
+#include "rts/rts_crowd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rts {
+
+static_assert(GRID_X % SECTOR_SIZE == 0 && GRID_Y % SECTOR_SIZE == 0);
+static_assert(SECTOR_SIZE % CROWD_DENSITY_CELL_SIZE == 0);
+
+void CrowdDensityFieldInit(CrowdDensityField *field) {
+  std::fill(std::begin(field->density), std::end(field->density), 0.0f);
+  std::fill(std::begin(field->appliedDensity),
+            std::end(field->appliedDensity), 0.0f);
+}
+
+void CrowdDensitySplat(CrowdDensityField *field, const float *positionsX,
+                       const float *positionsY, uint32_t count) {
+  std::fill(std::begin(field->density), std::end(field->density), 0.0f);
+  CoarseGridSplat(field->density, CROWD_DENSITY_X, CROWD_DENSITY_Y,
+                  CROWD_DENSITY_CELL_SIZE, positionsX, positionsY, nullptr,
+                  1.0f, count);
+}
+
+uint32_t CrowdDensityApply(CrowdDensityField *field, CostField *costField,
+                           const CrowdDensitySettings &settings) {
+  constexpr int densityCellsPerSector = SECTOR_SIZE / CROWD_DENSITY_CELL_SIZE;
+
+  uint32_t restampedCount = 0;
+
+  for (int sy = 0; sy < SECTOR_Y; sy++) {
+    for (int sx = 0; sx < SECTOR_X; sx++) {
+      const int dx0 = sx * densityCellsPerSector;
+      const int dy0 = sy * densityCellsPerSector;
+
+      // Skip sectors whose density did not move enough
+      float maxDelta = 0.0f;
+      for (int dy = dy0; dy < dy0 + densityCellsPerSector; dy++) {
+        for (int dx = dx0; dx < dx0 + densityCellsPerSector; dx++) {
+          int densityIdx = dy * CROWD_DENSITY_X + dx;
+          maxDelta = std::max(maxDelta,
+                              std::abs(field->density[densityIdx] -
+                                       field->appliedDensity[densityIdx]));
+        }
+      }
+
+      if (maxDelta <= settings.changeThreshold) {
+        continue;
+      }
+
+      // Restamp cells whose rounded cost moved
+      bool isSectorChanged = false;
+      for (int dy = dy0; dy < dy0 + densityCellsPerSector; dy++) {
+        for (int dx = dx0; dx < dx0 + densityCellsPerSector; dx++) {
+          int densityIdx = dy * CROWD_DENSITY_X + dx;
+          field->appliedDensity[densityIdx] = field->density[densityIdx];
+
+          int densityCost =
+              std::min(static_cast<int>(std::lround(
+                           field->density[densityIdx] * settings.costPerUnit)),
+                       settings.maxDensityCost);
+
+          CellRect rect;
+          rect.min = {dx * CROWD_DENSITY_CELL_SIZE,
+                      dy * CROWD_DENSITY_CELL_SIZE};
+          rect.max = {rect.min.x + CROWD_DENSITY_CELL_SIZE - 1,
+                      rect.min.y + CROWD_DENSITY_CELL_SIZE - 1};
+          isSectorChanged |= CostFieldSetDensity(costField, rect, densityCost);
+        }
+      }
+
+      if (!isSectorChanged) {
+        continue;
+      }
+
+      // Once per sector so flow fields see one change
+      CellRect sectorRect;
+      sectorRect.min = {sx * SECTOR_SIZE, sy * SECTOR_SIZE};
+      sectorRect.max = {sectorRect.min.x + SECTOR_SIZE - 1,
+                        sectorRect.min.y + SECTOR_SIZE - 1};
+      CostFieldTouchSectors(costField, sectorRect);
+      restampedCount++;
+    }
+  }
+
+  return restampedCount;
+}
+
+}; // namespace rts
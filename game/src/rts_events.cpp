@@ -0,0 +1,40 @@
+#include "rts/rts_events.h"
+
+#include <algorithm>
+
+namespace rts {
+
+void GameEventQueueReset(GameEventQueue *queue) {
+  for (GameEventBuffer &buffer : queue->buffers) {
+    buffer.events.clear();
+  }
+  queue->events.clear();
+}
+
+uint64_t GameEventOrderKey(uint32_t phase, uint32_t itemIdx) {
+  return (static_cast<uint64_t>(phase) << 32) | itemIdx;
+}
+
+uint32_t GameEventWriterIndex() {
+  const uint32_t threadIdx = JobSystemThreadIndex();
+  return threadIdx == JOB_THREAD_INDEX_NONE ? 0 : threadIdx;
+}
+
+void GameEventQueueMerge(GameEventQueue *queue) {
+  const size_t first = queue->events.size();
+
+  // Concatenate in writer order. Equal keys come from a single writer so the
+  // stable sort below keeps their append order.
+  for (GameEventBuffer &buffer : queue->buffers) {
+    queue->events.insert(queue->events.end(), buffer.events.begin(),
+                         buffer.events.end());
+    buffer.events.clear();
+  }
+
+  std::stable_sort(queue->events.begin() + first, queue->events.end(),
+                   [](const GameEvent &a, const GameEvent &b) {
+                     return a.orderKey < b.orderKey;
+                   });
+}
+
+}; // namespace rts
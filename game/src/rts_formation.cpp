@@ -0,0 +1,144 @@
+#include "rts/rts_formation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rts {
+
+// Neighbor swap passes after the row assignment
+static constexpr uint32_t sFormationSwapPasses = 2;
+
+// @returns slots in row 'rowIdx' of a full formation.
+static uint32_t FormationRowSize(FormationType type, uint32_t count,
+                                 uint32_t rowIdx) {
+  switch (type) {
+  case FORMATION_TYPE_LINE:
+    return count;
+  case FORMATION_TYPE_BOX:
+    return static_cast<uint32_t>(
+        std::ceil(std::sqrt(static_cast<float>(count))));
+  case FORMATION_TYPE_WEDGE:
+    return rowIdx + 1;
+  case FORMATION_TYPE_NONE:
+  case FORMATION_TYPE_COUNT:
+    break;
+  }
+
+  return count;
+}
+
+void FormationSlotsCreate(FormationType type, uint32_t count, float spacing,
+                          FormationSlot *outSlots) {
+  if (type == FORMATION_TYPE_NONE) {
+    std::fill(outSlots, outSlots + count, FormationSlot{{0.0f, 0.0f}, 0});
+    return;
+  }
+
+  float forwardSum = 0.0f;
+  uint32_t slotIdx = 0;
+  for (uint32_t rowIdx = 0; slotIdx < count; rowIdx++) {
+    const uint32_t rowCount =
+        std::min(FormationRowSize(type, count, rowIdx), count - slotIdx);
+    const float forward = -static_cast<float>(rowIdx) * spacing;
+
+    // Rows are centered, including a short last row
+    for (uint32_t i = 0; i < rowCount; i++) {
+      const float right =
+          (static_cast<float>(i) - 0.5f * static_cast<float>(rowCount - 1)) *
+          spacing;
+      outSlots[slotIdx++] = {{right, forward}, rowIdx};
+    }
+
+    forwardSum += forward * static_cast<float>(rowCount);
+  }
+
+  // Center on the middle of the formation rather than the front row
+  const float forwardMean = forwardSum / static_cast<float>(count);
+  for (uint32_t i = 0; i < count; i++) {
+    outSlots[i].offset.y -= forwardMean;
+  }
+}
+
+void FormationSlotsPlace(const FormationSlot *slots, uint32_t count,
+                         Vec2 center, Vec2 forward, Vec2 *outPositions) {
+  const Vec2 right = {forward.y, -forward.x};
+  for (uint32_t i = 0; i < count; i++) {
+    const Vec2 offset = slots[i].offset;
+    outPositions[i] = {center.x + right.x * offset.x + forward.x * offset.y,
+                       center.y + right.y * offset.x + forward.y * offset.y};
+  }
+}
+
+static float Distance(Vec2 a, Vec2 b) {
+  const float dx = a.x - b.x;
+  const float dy = a.y - b.y;
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+void FormationAssign(const FormationSlot *slots, const Vec2 *slotPositions,
+                     const Vec2 *unitPositions, uint32_t count, Vec2 forward,
+                     uint32_t *outSlotIdxs) {
+  const Vec2 right = {forward.y, -forward.x};
+
+  std::vector<uint32_t> unitOrder(count);
+  std::vector<float> forwardKeys(count);
+  std::vector<float> rightKeys(count);
+  for (uint32_t i = 0; i < count; i++) {
+    const Vec2 p = unitPositions[i];
+    unitOrder[i] = i;
+    forwardKeys[i] = p.x * forward.x + p.y * forward.y;
+    rightKeys[i] = p.x * right.x + p.y * right.y;
+  }
+
+  // Front most units fill the front rows
+  std::sort(unitOrder.begin(), unitOrder.end(),
+            [&](uint32_t a, uint32_t b) {
+              return forwardKeys[a] != forwardKeys[b]
+                         ? forwardKeys[a] > forwardKeys[b]
+                         : a < b;
+            });
+
+  // Slots are stored row by row, left to right. Match each row left to right.
+  std::vector<uint32_t> slotUnits(count);
+  for (uint32_t rowStart = 0; rowStart < count;) {
+    uint32_t rowEnd = rowStart + 1;
+    while (rowEnd < count && slots[rowEnd].row == slots[rowStart].row) {
+      rowEnd++;
+    }
+
+    std::sort(unitOrder.begin() + rowStart, unitOrder.begin() + rowEnd,
+              [&](uint32_t a, uint32_t b) {
+                return rightKeys[a] != rightKeys[b]
+                           ? rightKeys[a] < rightKeys[b]
+                           : a < b;
+              });
+
+    for (uint32_t slotIdx = rowStart; slotIdx < rowEnd; slotIdx++) {
+      slotUnits[slotIdx] = unitOrder[slotIdx];
+    }
+
+    rowStart = rowEnd;
+  }
+
+  // Swap neighboring slots when it shortens the total distance travelled
+  for (uint32_t pass = 0; pass < sFormationSwapPasses; pass++) {
+    for (uint32_t slotIdx = 0; slotIdx + 1 < count; slotIdx++) {
+      const Vec2 a = unitPositions[slotUnits[slotIdx]];
+      const Vec2 b = unitPositions[slotUnits[slotIdx + 1]];
+      const Vec2 slotA = slotPositions[slotIdx];
+      const Vec2 slotB = slotPositions[slotIdx + 1];
+
+      if (Distance(a, slotB) + Distance(b, slotA) <
+          Distance(a, slotA) + Distance(b, slotB)) {
+        std::swap(slotUnits[slotIdx], slotUnits[slotIdx + 1]);
+      }
+    }
+  }
+
+  for (uint32_t slotIdx = 0; slotIdx < count; slotIdx++) {
+    outSlotIdxs[slotUnits[slotIdx]] = slotIdx;
+  }
+}
+
+}; // namespace rts
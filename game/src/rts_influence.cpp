@@ -0,0 +1,159 @@
+#include "rts/rts_influence.h"
+
+#include <algorithm>
+
+// The AVX blur is built with a target attribute and picked at runtime, so
+// default x86-64 builds use it on CPUs that have it without '-mavx'
+#if defined(__AVX__) ||                                                        \
+    (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+#define INFLUENCE_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define INFLUENCE_TARGET_AVX __attribute__((target("avx")))
+#else
+#define INFLUENCE_TARGET_AVX
+#endif
+
+namespace rts {
+
+static_assert(GRID_X % INFLUENCE_CELL_SIZE == 0 &&
+              GRID_Y % INFLUENCE_CELL_SIZE == 0);
+
+void InfluenceMapInit(InfluenceMap *map) {
+  for (float *layer : map->layers) {
+    std::fill(layer, layer + INFLUENCE_X * INFLUENCE_Y, 0.0f);
+  }
+}
+
+// @brief out = (left + 2 * center + right) / 4 * scale over 'count' floats.
+// @note Both versions round identically so results do not depend on the CPU.
+typedef void (*Blur3Fn)(const float *left, const float *center,
+                        const float *right, float *out, uint32_t count,
+                        float scale);
+
+static void Blur3(const float *left, const float *center, const float *right,
+                  float *out, uint32_t count, float scale) {
+  const float quarter = 0.25f * scale;
+  const float half = 0.5f * scale;
+  for (uint32_t i = 0; i < count; i++) {
+    out[i] = (left[i] + right[i]) * quarter + center[i] * half;
+  }
+}
+
+#if defined(INFLUENCE_AVX)
+INFLUENCE_TARGET_AVX static void Blur3Avx(const float *left,
+                                          const float *center,
+                                          const float *right, float *out,
+                                          uint32_t count, float scale) {
+  const __m256 quarter = _mm256_set1_ps(0.25f * scale);
+  const __m256 half = _mm256_set1_ps(0.5f * scale);
+
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 sides =
+        _mm256_add_ps(_mm256_loadu_ps(left + i), _mm256_loadu_ps(right + i));
+    __m256 middle = _mm256_mul_ps(_mm256_loadu_ps(center + i), half);
+    __m256 sum = _mm256_add_ps(_mm256_mul_ps(sides, quarter), middle);
+    _mm256_storeu_ps(out + i, sum);
+  }
+
+  Blur3(left + i, center + i, right + i, out + i, count - i, scale);
+}
+#endif
+
+static Blur3Fn Blur3Select() {
+#if defined(__AVX__)
+  return Blur3Avx;
+#elif defined(INFLUENCE_AVX)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx") ? Blur3Avx : Blur3;
+#else
+  return Blur3;
+#endif
+}
+
+// @brief Separable blur of 'layer' through 'scratch'. Edges are clamped.
+static void LayerBlur(float *layer, float *scratch, float decay) {
+  static const Blur3Fn sBlur3 = Blur3Select();
+
+  // Horizontal
+  for (int y = 0; y < INFLUENCE_Y; y++) {
+    const float *row = layer + y * INFLUENCE_X;
+    float *out = scratch + y * INFLUENCE_X;
+
+    out[0] = row[0] * 0.75f + row[1] * 0.25f;
+    sBlur3(row, row + 1, row + 2, out + 1, INFLUENCE_X - 2, 1.0f);
+    out[INFLUENCE_X - 1] =
+        row[INFLUENCE_X - 1] * 0.75f + row[INFLUENCE_X - 2] * 0.25f;
+  }
+
+  // Vertical. Rows are contiguous so whole rows are blurred at once.
+  for (int y = 0; y < INFLUENCE_Y; y++) {
+    const float *up = scratch + std::max(y - 1, 0) * INFLUENCE_X;
+    const float *down =
+        scratch + std::min(y + 1, INFLUENCE_Y - 1) * INFLUENCE_X;
+    sBlur3(up, scratch + y * INFLUENCE_X, down, layer + y * INFLUENCE_X,
+           INFLUENCE_X, decay);
+  }
+}
+
+void InfluenceLayerUpdate(InfluenceMap *map, uint32_t team,
+                          const float *positionsX, const float *positionsY,
+                          const float *strengths, uint32_t count,
+                          const InfluenceSettings &settings) {
+  float *layer = map->layers[team];
+  LayerBlur(layer, map->scratch, settings.decay);
+  CoarseGridSplat(layer, INFLUENCE_X, INFLUENCE_Y, INFLUENCE_CELL_SIZE,
+                  positionsX, positionsY, strengths, settings.strengthScale,
+                  count);
+}
+
+template <typename Compare>
+static float RegionFind(const InfluenceMap *map, uint32_t team,
+                        CellRect region, IVec2 *outCell, Compare compare) {
+  const float *layer = map->layers[team];
+
+  const int minX = std::clamp(region.min.x / INFLUENCE_CELL_SIZE, 0,
+                              INFLUENCE_X - 1);
+  const int minY = std::clamp(region.min.y / INFLUENCE_CELL_SIZE, 0,
+                              INFLUENCE_Y - 1);
+  const int maxX = std::clamp(region.max.x / INFLUENCE_CELL_SIZE, 0,
+                              INFLUENCE_X - 1);
+  const int maxY = std::clamp(region.max.y / INFLUENCE_CELL_SIZE, 0,
+                              INFLUENCE_Y - 1);
+
+  int bestIdx = minY * INFLUENCE_X + minX;
+  for (int y = minY; y <= maxY; y++) {
+    for (int x = minX; x <= maxX; x++) {
+      int cellIdx = y * INFLUENCE_X + x;
+      if (compare(layer[cellIdx], layer[bestIdx])) {
+        bestIdx = cellIdx;
+      }
+    }
+  }
+
+  if (outCell) {
+    *outCell = {(bestIdx % INFLUENCE_X) * INFLUENCE_CELL_SIZE +
+                    INFLUENCE_CELL_SIZE / 2,
+                (bestIdx / INFLUENCE_X) * INFLUENCE_CELL_SIZE +
+                    INFLUENCE_CELL_SIZE / 2};
+  }
+
+  return layer[bestIdx];
+}
+
+float InfluenceRegionMax(const InfluenceMap *map, uint32_t team,
+                         CellRect region, IVec2 *outCell) {
+  return RegionFind(map, team, region, outCell,
+                    [](float a, float b) { return a > b; });
+}
+
+float InfluenceRegionMin(const InfluenceMap *map, uint32_t team,
+                         CellRect region, IVec2 *outCell) {
+  return RegionFind(map, team, region, outCell,
+                    [](float a, float b) { return a < b; });
+}
+
+}; // namespace rts
@@ -0,0 +1,200 @@
+#include "rts/rts_job.h"
+
+#include <algorithm>
+
+namespace rts {
+
+static thread_local uint32_t sThreadIdx = JOB_THREAD_INDEX_NONE;
+
+// Wakes sleeping threads. Taking the mutex first keeps a thread from missing
+// the change between checking and starting to sleep.
+static void JobSystemWake(JobSystem *jobs) {
+  { std::lock_guard<std::mutex> lock(jobs->sleepMutex); }
+  jobs->wake.notify_all();
+}
+
+static bool JobDequePop(JobDeque *deque, bool isBack, Job *outJob) {
+  std::lock_guard<std::mutex> lock(deque->mutex);
+  if (deque->jobs.empty()) {
+    return false;
+  }
+
+  if (isBack) {
+    *outJob = std::move(deque->jobs.back());
+    deque->jobs.pop_back();
+  } else {
+    *outJob = std::move(deque->jobs.front());
+    deque->jobs.pop_front();
+  }
+
+  return true;
+}
+
+static bool JobFind(JobSystem *jobs, Job *outJob) {
+  const uint32_t threadIdx = sThreadIdx;
+
+  if (threadIdx == 0 && jobs->queuedMainCount > 0 &&
+      JobDequePop(&jobs->mainThreadJobs, false, outJob)) {
+    jobs->queuedMainCount--;
+    return true;
+  }
+
+  if (jobs->queuedCount == 0) {
+    return false;
+  }
+
+  // Own jobs newest first while they are still in cache
+  if (threadIdx != JOB_THREAD_INDEX_NONE &&
+      JobDequePop(&jobs->deques[threadIdx], true, outJob)) {
+    jobs->queuedCount--;
+    return true;
+  }
+
+  // Steal the oldest job of another thread
+  const uint32_t firstIdx = threadIdx == JOB_THREAD_INDEX_NONE ? 0 : threadIdx;
+  for (uint32_t i = 1; i <= jobs->threadCount; i++) {
+    const uint32_t victimIdx = (firstIdx + i) % jobs->threadCount;
+    if (JobDequePop(&jobs->deques[victimIdx], false, outJob)) {
+      jobs->queuedCount--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool JobRunOne(JobSystem *jobs) {
+  Job job;
+  if (!JobFind(jobs, &job)) {
+    return false;
+  }
+
+  job.fn();
+
+  if (job.counter->value.fetch_sub(1) == 1) {
+    JobSystemWake(jobs);
+  }
+
+  return true;
+}
+
+static void JobWorkerLoop(JobSystem *jobs, uint32_t threadIdx) {
+  sThreadIdx = threadIdx;
+
+  while (!jobs->isStopping) {
+    if (JobRunOne(jobs)) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(jobs->sleepMutex);
+    jobs->wake.wait(lock, [jobs]() {
+      return jobs->isStopping || jobs->queuedCount > 0;
+    });
+  }
+}
+
+void JobSystemInit(JobSystem *jobs, uint32_t workerCount) {
+  if (!jobs->workers.empty()) {
+    JobSystemShutdown(jobs);
+  }
+
+  sThreadIdx = 0;
+  jobs->threadCount = std::min(workerCount + 1, uint32_t(JOB_MAX_THREADS));
+  jobs->queuedCount = 0;
+  jobs->queuedMainCount = 0;
+  jobs->isStopping = false;
+
+  jobs->workers.reserve(jobs->threadCount - 1);
+  for (uint32_t i = 1; i < jobs->threadCount; i++) {
+    jobs->workers.emplace_back(JobWorkerLoop, jobs, i);
+  }
+}
+
+void JobSystemShutdown(JobSystem *jobs) {
+  jobs->isStopping = true;
+  JobSystemWake(jobs);
+
+  for (std::thread &worker : jobs->workers) {
+    worker.join();
+  }
+  jobs->workers.clear();
+
+  for (JobDeque &deque : jobs->deques) {
+    deque.jobs.clear();
+  }
+  jobs->mainThreadJobs.jobs.clear();
+  jobs->queuedCount = 0;
+  jobs->queuedMainCount = 0;
+}
+
+void JobSystemSubmit(JobSystem *jobs, std::function<void()> fn,
+                     JobCounter *counter, uint32_t flags) {
+  counter->value++;
+
+  // Counted after pushing, under the deque's lock, so a job is never counted
+  // before it can be popped and a pop never decrements before the count
+  if (flags & JOB_FLAGS_MAIN_THREAD) {
+    std::lock_guard<std::mutex> lock(jobs->mainThreadJobs.mutex);
+    jobs->mainThreadJobs.jobs.push_back({std::move(fn), counter});
+    jobs->queuedMainCount++;
+  } else {
+    // Threads outside the job system hand their jobs to the main thread's
+    // deque, where workers steal them
+    const uint32_t threadIdx =
+        sThreadIdx == JOB_THREAD_INDEX_NONE ? 0 : sThreadIdx;
+
+    JobDeque &deque = jobs->deques[threadIdx];
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    deque.jobs.push_back({std::move(fn), counter});
+    jobs->queuedCount++;
+  }
+
+  JobSystemWake(jobs);
+}
+
+void JobSystemWait(JobSystem *jobs, JobCounter *counter) {
+  const bool isMainThread = sThreadIdx == 0;
+
+  while (counter->value > 0) {
+    if (JobRunOne(jobs)) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(jobs->sleepMutex);
+    jobs->wake.wait(lock, [jobs, counter, isMainThread]() {
+      return counter->value == 0 || jobs->queuedCount > 0 ||
+             (isMainThread && jobs->queuedMainCount > 0);
+    });
+  }
+}
+
+void JobSystemParallelFor(JobSystem *jobs, uint32_t count, uint32_t grainSize,
+                          const std::function<void(uint32_t, uint32_t)> &fn) {
+  const uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+  if (chunkCount == 0) {
+    return;
+  }
+
+  std::atomic<uint32_t> nextChunk = 0;
+  const auto runChunks = [&]() {
+    for (uint32_t chunk = nextChunk++; chunk < chunkCount;
+         chunk = nextChunk++) {
+      const uint32_t begin = chunk * grainSize;
+      fn(begin, std::min(begin + grainSize, count));
+    }
+  };
+
+  // The calling thread takes the first share
+  JobCounter counter;
+  const uint32_t jobCount = std::min(chunkCount, jobs->threadCount);
+  for (uint32_t i = 1; i < jobCount; i++) {
+    JobSystemSubmit(jobs, runChunks, &counter);
+  }
+
+  runChunks();
+  JobSystemWait(jobs, &counter);
+}
+
+uint32_t JobSystemThreadIndex() { return sThreadIdx; }
+
+}; // namespace rts
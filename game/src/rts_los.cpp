@@ -0,0 +1,286 @@
+#include "rts/rts_los.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// The AVX2 traversal is built with a target attribute and picked at runtime,
+// so default x86-64 builds use it on CPUs that have it without '-mavx2'
+#if defined(__AVX2__) ||                                                       \
+    (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+#define LOS_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define LOS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LOS_TARGET_AVX2
+#endif
+
+namespace rts {
+
+static_assert(GRID_X % 32 == 0);
+
+// Queries traversed together
+#define LOS_PACKET_SIZE 8
+
+void BlockingBitplaneCreate(const int *costField, BlockingBitplane *out) {
+  memset(out->words, 0, sizeof(out->words));
+
+  for (int y = 0; y < GRID_Y; y++) {
+    for (int x = 0; x < GRID_X; x++) {
+      if (costField[y * GRID_X + x] >= COST_IMPASSABLE) {
+        out->words[y * BLOCKING_WORDS_PER_ROW + (x >> 5)] |= 1u << (x & 31);
+      }
+    }
+  }
+}
+
+void BlockingBitplaneSet(BlockingBitplane *plane, IVec2 cell,
+                         bool isBlocking) {
+  uint32_t &word =
+      plane->words[cell.y * BLOCKING_WORDS_PER_ROW + (cell.x >> 5)];
+  if (isBlocking) {
+    word |= 1u << (cell.x & 31);
+  } else {
+    word &= ~(1u << (cell.x & 31));
+  }
+}
+
+// Grid walk state for a packet of queries in SoA
+struct LineOfSightPacket {
+  alignas(32) int32_t x[LOS_PACKET_SIZE];
+  alignas(32) int32_t y[LOS_PACKET_SIZE];
+  alignas(32) int32_t signX[LOS_PACKET_SIZE];
+  alignas(32) int32_t signY[LOS_PACKET_SIZE];
+  alignas(32) int32_t countX[LOS_PACKET_SIZE];
+  alignas(32) int32_t countY[LOS_PACKET_SIZE];
+  int32_t maxStepCount;
+
+  // Lanes with an endpoint off the grid. Never visible.
+  uint32_t outsideMask;
+};
+
+static bool CellIsInGrid(IVec2 cell) {
+  return cell.x >= 0 && cell.x < GRID_X && cell.y >= 0 && cell.y < GRID_Y;
+}
+
+static void LineOfSightPacketInit(const LineOfSightQuery *queries,
+                                  uint32_t count, LineOfSightPacket *packet) {
+  packet->maxStepCount = 0;
+  packet->outsideMask = 0;
+
+  for (uint32_t lane = 0; lane < LOS_PACKET_SIZE; lane++) {
+    // Pad with empty queries
+    if (lane >= count || !CellIsInGrid(queries[lane].from) ||
+        !CellIsInGrid(queries[lane].to)) {
+      packet->x[lane] = packet->y[lane] = 0;
+      packet->signX[lane] = packet->signY[lane] = 0;
+      packet->countX[lane] = packet->countY[lane] = 0;
+      packet->outsideMask |= (lane < count ? 1u : 0u) << lane;
+      continue;
+    }
+
+    const LineOfSightQuery &query = queries[lane];
+    const int dx = query.to.x - query.from.x;
+    const int dy = query.to.y - query.from.y;
+
+    packet->x[lane] = query.from.x;
+    packet->y[lane] = query.from.y;
+    packet->signX[lane] = dx < 0 ? -1 : 1;
+    packet->signY[lane] = dy < 0 ? -1 : 1;
+    packet->countX[lane] = std::abs(dx);
+    packet->countY[lane] = std::abs(dy);
+    packet->maxStepCount =
+        std::max(packet->maxStepCount, std::abs(dx) + std::abs(dy));
+  }
+}
+
+static uint32_t CellIsBlocking(const BlockingBitplane *plane, int x, int y) {
+  const uint32_t word = plane->words[y * BLOCKING_WORDS_PER_ROW + (x >> 5)];
+  return (word >> (x & 31)) & 1u;
+}
+
+#if defined(LOS_AVX2)
+static bool CpuHasAvx2() {
+#if defined(__AVX2__)
+  return true;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// @returns lanes of 'mask' whose cell blocks
+LOS_TARGET_AVX2 static __m256i BlockingGather(const BlockingBitplane *plane,
+                                              __m256i x, __m256i y,
+                                              __m256i mask) {
+  static_assert(BLOCKING_WORDS_PER_ROW == 8);
+  const int *words = reinterpret_cast<const int *>(plane->words);
+  const __m256i one = _mm256_set1_epi32(1);
+
+  __m256i wordIdx =
+      _mm256_add_epi32(_mm256_slli_epi32(y, 3), _mm256_srai_epi32(x, 5));
+  __m256i word = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), words,
+                                             wordIdx, mask, 4);
+  __m256i bit = _mm256_and_si256(
+      _mm256_srlv_epi32(word, _mm256_and_si256(x, _mm256_set1_epi32(31))),
+      one);
+
+  return _mm256_and_si256(mask, _mm256_cmpeq_epi32(bit, one));
+}
+
+// @brief 'LineOfSightPacketTraverse' with all lanes in one register.
+LOS_TARGET_AVX2 static uint32_t
+LineOfSightPacketTraverseAvx2(const BlockingBitplane *plane,
+                              LineOfSightPacket *packet) {
+  __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i *>(packet->x));
+  __m256i y = _mm256_load_si256(reinterpret_cast<const __m256i *>(packet->y));
+  const __m256i signX =
+      _mm256_load_si256(reinterpret_cast<const __m256i *>(packet->signX));
+  const __m256i signY =
+      _mm256_load_si256(reinterpret_cast<const __m256i *>(packet->signY));
+  const __m256i countX =
+      _mm256_load_si256(reinterpret_cast<const __m256i *>(packet->countX));
+  const __m256i countY =
+      _mm256_load_si256(reinterpret_cast<const __m256i *>(packet->countY));
+
+  const __m256i one = _mm256_set1_epi32(1);
+  __m256i stepX = _mm256_setzero_si256();
+  __m256i stepY = _mm256_setzero_si256();
+  __m256i blocked = _mm256_setzero_si256();
+
+  for (int i = 0; i < packet->maxStepCount; i++) {
+    // Lanes short of 'to' and not yet blocked
+    __m256i active = _mm256_andnot_si256(
+        blocked, _mm256_or_si256(_mm256_cmpgt_epi32(countX, stepX),
+                                 _mm256_cmpgt_epi32(countY, stepY)));
+    if (_mm256_testz_si256(active, active)) {
+      break;
+    }
+
+    __m256i crossX = _mm256_mullo_epi32(
+        _mm256_add_epi32(_mm256_slli_epi32(stepX, 1), one), countY);
+    __m256i crossY = _mm256_mullo_epi32(
+        _mm256_add_epi32(_mm256_slli_epi32(stepY, 1), one), countX);
+
+    // Corner cells
+    __m256i tie = _mm256_and_si256(active, _mm256_cmpeq_epi32(crossX, crossY));
+    if (!_mm256_testz_si256(tie, tie)) {
+      blocked = _mm256_or_si256(
+          blocked, BlockingGather(plane, _mm256_add_epi32(x, signX), y, tie));
+      blocked = _mm256_or_si256(
+          blocked, BlockingGather(plane, x, _mm256_add_epi32(y, signY), tie));
+    }
+
+    __m256i moveX =
+        _mm256_andnot_si256(_mm256_cmpgt_epi32(crossX, crossY), active);
+    __m256i moveY =
+        _mm256_andnot_si256(_mm256_cmpgt_epi32(crossY, crossX), active);
+    x = _mm256_add_epi32(x, _mm256_and_si256(moveX, signX));
+    y = _mm256_add_epi32(y, _mm256_and_si256(moveY, signY));
+    stepX = _mm256_sub_epi32(stepX, moveX);
+    stepY = _mm256_sub_epi32(stepY, moveY);
+
+    // 'to' itself is not tested
+    __m256i isBetween = _mm256_and_si256(
+        active, _mm256_or_si256(_mm256_cmpgt_epi32(countX, stepX),
+                                _mm256_cmpgt_epi32(countY, stepY)));
+    blocked = _mm256_or_si256(blocked, BlockingGather(plane, x, y, isBetween));
+  }
+
+  return static_cast<uint32_t>(
+      _mm256_movemask_ps(_mm256_castsi256_ps(blocked)));
+}
+#endif
+
+// @returns lane mask of blocked queries
+// @note Steps one cell along x or y at a time, picking the axis whose next
+// cell border the segment crosses first: x while (1 + 2 * ix) * countY is
+// smaller than (1 + 2 * iy) * countX. On a tie the segment passes exactly
+// through a corner, so both cells sharing it are tested before stepping
+// diagonally.
+static uint32_t LineOfSightPacketTraverse(const BlockingBitplane *plane,
+                                          LineOfSightPacket *packet) {
+  uint32_t blocked = 0;
+  int32_t stepX[LOS_PACKET_SIZE] = {};
+  int32_t stepY[LOS_PACKET_SIZE] = {};
+
+  for (int i = 0; i < packet->maxStepCount; i++) {
+    uint32_t activeCount = 0;
+
+    for (uint32_t lane = 0; lane < LOS_PACKET_SIZE; lane++) {
+      const int countX = packet->countX[lane];
+      const int countY = packet->countY[lane];
+      if ((blocked & (1u << lane)) ||
+          (stepX[lane] == countX && stepY[lane] == countY)) {
+        continue;
+      }
+      activeCount++;
+
+      int &x = packet->x[lane];
+      int &y = packet->y[lane];
+      const int crossX = (1 + 2 * stepX[lane]) * countY;
+      const int crossY = (1 + 2 * stepY[lane]) * countX;
+
+      // Corner cells
+      if (crossX == crossY) {
+        blocked |= (CellIsBlocking(plane, x + packet->signX[lane], y) |
+                    CellIsBlocking(plane, x, y + packet->signY[lane]))
+                   << lane;
+      }
+
+      if (crossX <= crossY) {
+        x += packet->signX[lane];
+        stepX[lane]++;
+      }
+      if (crossY <= crossX) {
+        y += packet->signY[lane];
+        stepY[lane]++;
+      }
+
+      // 'to' itself is not tested
+      if (stepX[lane] < countX || stepY[lane] < countY) {
+        blocked |= CellIsBlocking(plane, x, y) << lane;
+      }
+    }
+
+    if (activeCount == 0) {
+      break;
+    }
+  }
+
+  return blocked;
+}
+
+void LineOfSightBatch(const BlockingBitplane *plane,
+                      const LineOfSightQuery *queries, uint32_t count,
+                      uint64_t *outVisible) {
+  memset(outVisible, 0, sizeof(uint64_t) * ((count + 63) / 64));
+
+#if defined(LOS_AVX2)
+  static const bool sHasAvx2 = CpuHasAvx2();
+  auto traverse =
+      sHasAvx2 ? LineOfSightPacketTraverseAvx2 : LineOfSightPacketTraverse;
+#else
+  auto traverse = LineOfSightPacketTraverse;
+#endif
+
+  LineOfSightPacket packet;
+  for (uint32_t first = 0; first < count; first += LOS_PACKET_SIZE) {
+    const uint32_t laneCount =
+        std::min<uint32_t>(LOS_PACKET_SIZE, count - first);
+
+    LineOfSightPacketInit(queries + first, laneCount, &packet);
+    uint32_t visible =
+        ~(traverse(plane, &packet) | packet.outsideMask) &
+        ((1u << laneCount) - 1);
+
+    // Packets never straddle a result word
+    static_assert(64 % LOS_PACKET_SIZE == 0);
+    outVisible[first / 64] |= static_cast<uint64_t>(visible) << (first % 64);
+  }
+}
+
+}; // namespace rts
@@ -0,0 +1,164 @@
+#include "rts/rts_minimap.h"
+
+#include <algorithm>
+
+namespace rts {
+
+static constexpr MinimapPixel sObstacleColor = {48, 48, 48, 255};
+static constexpr MinimapPixel sUnitColor = {255, 255, 255, 255};
+
+// Fogged pixels keep 1 / 'sFogDarkening' of their brightness
+static constexpr uint32_t sFogDarkening = 4;
+
+static MinimapPixel CellColor(const CostField *field, int cellIdx) {
+  if (field->obstacleCosts[cellIdx] >= COST_IMPASSABLE) {
+    return sObstacleColor;
+  }
+
+  switch (field->terrain[cellIdx]) {
+  case CELL_TYPE_GROUND:
+    return {86, 125, 70, 255};
+  case CELL_TYPE_MUD:
+    return {110, 85, 55, 255};
+  case CELL_TYPE_WATER:
+    return {40, 80, 160, 255};
+  case CELL_TYPE_NONE:
+  case CELL_TYPE_COUNT:
+    break;
+  }
+
+  return {0, 0, 0, 255};
+}
+
+static void PixelMarkDirty(Minimap *minimap, uint32_t pixelIdx) {
+  if (!minimap->isPixelDirty[pixelIdx]) {
+    minimap->isPixelDirty[pixelIdx] = 1;
+    minimap->dirtyPixels.push_back(pixelIdx);
+  }
+}
+
+static void RowTouch(Minimap *minimap, int row) {
+  minimap->dirtyRowMin = std::min(minimap->dirtyRowMin, row);
+  minimap->dirtyRowMax = std::max(minimap->dirtyRowMax, row);
+}
+
+void MinimapInit(Minimap *minimap) {
+  minimap->background.assign(MINIMAP_X * MINIMAP_Y, {0, 0, 0, 255});
+  minimap->pixels.assign(MINIMAP_X * MINIMAP_Y, {0, 0, 0, 255});
+  minimap->fogged.assign(MINIMAP_X * MINIMAP_Y, 0);
+  minimap->isPixelDirty.assign(MINIMAP_X * MINIMAP_Y, 0);
+  minimap->dirtyPixels.clear();
+  minimap->unitPixels.clear();
+
+  // Version 0 is never used so every sector is recolored on the first update
+  minimap->sectorVersions.assign(SECTOR_X * SECTOR_Y, 0);
+
+  minimap->dirtyRowMin = MINIMAP_Y;
+  minimap->dirtyRowMax = -1;
+}
+
+void MinimapSetFog(Minimap *minimap, IVec2 cell, bool isFogged) {
+  const uint32_t pixelIdx = (cell.y / MINIMAP_CELL_SIZE) * MINIMAP_X +
+                            cell.x / MINIMAP_CELL_SIZE;
+  if (static_cast<bool>(minimap->fogged[pixelIdx]) == isFogged) {
+    return;
+  }
+
+  minimap->fogged[pixelIdx] = isFogged;
+  PixelMarkDirty(minimap, pixelIdx);
+}
+
+void MinimapUpdate(Minimap *minimap, const CostField *costField,
+                   const UnitGrid *unitGrid, uint64_t frameIdx) {
+  // Sectors restamped since the last update
+  constexpr int sectorPixels = SECTOR_SIZE / MINIMAP_CELL_SIZE;
+  for (int sy = 0; sy < SECTOR_Y; sy++) {
+    for (int sx = 0; sx < SECTOR_X; sx++) {
+      const int sectorIdx = sy * SECTOR_X + sx;
+      if (minimap->sectorVersions[sectorIdx] ==
+          costField->sectorVersions[sectorIdx]) {
+        continue;
+      }
+
+      minimap->sectorVersions[sectorIdx] = costField->sectorVersions[sectorIdx];
+      for (int y = sy * sectorPixels; y < (sy + 1) * sectorPixels; y++) {
+        for (int x = sx * sectorPixels; x < (sx + 1) * sectorPixels; x++) {
+          PixelMarkDirty(minimap, y * MINIMAP_X + x);
+        }
+      }
+    }
+  }
+
+  // Average the cells under each dirty pixel
+  for (uint32_t pixelIdx : minimap->dirtyPixels) {
+    const int px = static_cast<int>(pixelIdx % MINIMAP_X);
+    const int py = static_cast<int>(pixelIdx / MINIMAP_X);
+
+    uint32_t r = 0;
+    uint32_t g = 0;
+    uint32_t b = 0;
+    for (int y = 0; y < MINIMAP_CELL_SIZE; y++) {
+      for (int x = 0; x < MINIMAP_CELL_SIZE; x++) {
+        const int cellIdx = (py * MINIMAP_CELL_SIZE + y) * GRID_X +
+                            px * MINIMAP_CELL_SIZE + x;
+        const MinimapPixel color = CellColor(costField, cellIdx);
+        r += color.r;
+        g += color.g;
+        b += color.b;
+      }
+    }
+
+    uint32_t divisor = MINIMAP_CELL_SIZE * MINIMAP_CELL_SIZE;
+    if (minimap->fogged[pixelIdx]) {
+      divisor *= sFogDarkening;
+    }
+
+    const MinimapPixel color = {static_cast<uint8_t>(r / divisor),
+                                static_cast<uint8_t>(g / divisor),
+                                static_cast<uint8_t>(b / divisor), 255};
+
+    // Unit dots over the pixel are lost until the next unit raster
+    minimap->background[pixelIdx] = color;
+    minimap->pixels[pixelIdx] = color;
+    minimap->isPixelDirty[pixelIdx] = 0;
+    RowTouch(minimap, py);
+  }
+  minimap->dirtyPixels.clear();
+
+  if (frameIdx % MINIMAP_UNIT_UPDATE_INTERVAL != 0) {
+    return;
+  }
+
+  // Restore the background under the last dots
+  for (uint32_t pixelIdx : minimap->unitPixels) {
+    minimap->pixels[pixelIdx] = minimap->background[pixelIdx];
+    RowTouch(minimap, static_cast<int>(pixelIdx / MINIMAP_X));
+  }
+  minimap->unitPixels.clear();
+
+  const uint32_t unitCount = static_cast<uint32_t>(unitGrid->units.size());
+  for (uint32_t i = 0; i < unitCount; i++) {
+    const int px = std::clamp(
+        static_cast<int>(unitGrid->positionsX[i]) / MINIMAP_CELL_SIZE, 0,
+        MINIMAP_X - 1);
+    const int py = std::clamp(
+        static_cast<int>(unitGrid->positionsY[i]) / MINIMAP_CELL_SIZE, 0,
+        MINIMAP_Y - 1);
+    const uint32_t pixelIdx = py * MINIMAP_X + px;
+
+    if (minimap->fogged[pixelIdx]) {
+      continue;
+    }
+
+    minimap->pixels[pixelIdx] = sUnitColor;
+    minimap->unitPixels.push_back(pixelIdx);
+    RowTouch(minimap, py);
+  }
+}
+
+void MinimapClearDirtyRows(Minimap *minimap) {
+  minimap->dirtyRowMin = MINIMAP_Y;
+  minimap->dirtyRowMax = -1;
+}
+
+}; // namespace rts
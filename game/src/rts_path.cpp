@@ -0,0 +1,367 @@
+#include "rts/rts.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace rts {
+
+static constexpr int sStraightStepCost = STEP_COST_STRAIGHT;
+static constexpr int sDiagonalStepCost = STEP_COST_DIAGONAL;
+
+// @note Scratch is stamped with a search generation so a search only touches
+// the cells it expands instead of clearing the whole grid.
+struct PathScratch {
+  std::vector<uint32_t> openGeneration;
+  std::vector<uint32_t> closedGeneration;
+  std::vector<int> g;
+  std::vector<int> parent;
+  uint32_t generation = 0;
+
+  // Cells walked by jumps during the current search
+  uint32_t cellsVisited = 0;
+};
+
+static thread_local PathScratch sScratch;
+
+static inline bool IsPassable(const int *costField, int x, int y) {
+  return x >= 0 && x < GRID_X && y >= 0 && y < GRID_Y &&
+         costField[y * GRID_X + x] < COST_IMPASSABLE;
+}
+
+// @brief True if every passable cell around (x, y) costs 'cost'.
+static bool IsUniform(const int *costField, int x, int y, int cost) {
+  for (int dy = -1; dy <= 1; dy++) {
+    for (int dx = -1; dx <= 1; dx++) {
+      if (!IsPassable(costField, x + dx, y + dy)) {
+        continue;
+      }
+
+      if (costField[(y + dy) * GRID_X + (x + dx)] != cost) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static inline int OctileDistance(int x0, int y0, int x1, int y1) {
+  int dx = std::abs(x1 - x0);
+  int dy = std::abs(y1 - y0);
+  return sStraightStepCost * std::max(dx, dy) +
+         (sDiagonalStepCost - sStraightStepCost) * std::min(dx, dy);
+}
+
+// @brief Walks from (x, y) in a straight line through a region of 'cost'.
+// @returns the cell index of the jump point or -1 if none.
+static int JumpStraight(const int *costField, int x, int y, int dx, int dy,
+                        IVec2 goal, int cost) {
+  while (true) {
+    sScratch.cellsVisited++;
+    if (!IsPassable(costField, x, y) || costField[y * GRID_X + x] != cost) {
+      return -1;
+    }
+
+    const int cellIdx = y * GRID_X + x;
+    if (x == goal.x && y == goal.y) {
+      return cellIdx;
+    }
+
+    // Leaving the uniform region
+    if (!IsUniform(costField, x, y, cost)) {
+      return cellIdx;
+    }
+
+    // Forced neighbors
+    if (dx != 0) {
+      if ((IsPassable(costField, x, y - 1) &&
+           !IsPassable(costField, x - dx, y - 1)) ||
+          (IsPassable(costField, x, y + 1) &&
+           !IsPassable(costField, x - dx, y + 1))) {
+        return cellIdx;
+      }
+    } else {
+      if ((IsPassable(costField, x - 1, y) &&
+           !IsPassable(costField, x - 1, y - dy)) ||
+          (IsPassable(costField, x + 1, y) &&
+           !IsPassable(costField, x + 1, y - dy))) {
+        return cellIdx;
+      }
+    }
+
+    x += dx;
+    y += dy;
+  }
+}
+
+// @brief Walks from (x, y) diagonally through a region of 'cost'.
+// @returns the cell index of the jump point or -1 if none.
+static int JumpDiagonal(const int *costField, int x, int y, int dx, int dy,
+                        IVec2 goal, int cost) {
+  while (true) {
+    sScratch.cellsVisited++;
+    if (!IsPassable(costField, x, y) || costField[y * GRID_X + x] != cost) {
+      return -1;
+    }
+
+    const int cellIdx = y * GRID_X + x;
+    if (x == goal.x && y == goal.y) {
+      return cellIdx;
+    }
+
+    if (!IsUniform(costField, x, y, cost)) {
+      return cellIdx;
+    }
+
+    // Straight jump points reachable from this diagonal
+    if (JumpStraight(costField, x + dx, y, dx, 0, goal, cost) != -1 ||
+        JumpStraight(costField, x, y + dy, 0, dy, goal, cost) != -1) {
+      return cellIdx;
+    }
+
+    // No corner cutting
+    if (!IsPassable(costField, x + dx, y) ||
+        !IsPassable(costField, x, y + dy)) {
+      return -1;
+    }
+
+    x += dx;
+    y += dy;
+  }
+}
+
+static int Jump(const int *costField, int x, int y, int dx, int dy,
+                IVec2 goal) {
+  if (!IsPassable(costField, x, y)) {
+    return -1;
+  }
+
+  const int cost = costField[y * GRID_X + x];
+  if (dx != 0 && dy != 0) {
+    return JumpDiagonal(costField, x, y, dx, dy, goal, cost);
+  }
+
+  return JumpStraight(costField, x, y, dx, dy, goal, cost);
+}
+
+uint32_t PathCreate(const int *costField, IVec2 start, IVec2 goal,
+                    IVec2 *outPath, uint32_t maxWaypoints,
+                    PathingStats *stats) {
+  if (stats) {
+    stats->cellsExpanded = 0;
+    stats->cellsVisited = 0;
+  }
+
+  if (!IsPassable(costField, start.x, start.y) ||
+      !IsPassable(costField, goal.x, goal.y)) {
+    return 0;
+  }
+
+  if (start.x == goal.x && start.y == goal.y) {
+    return 0;
+  }
+
+  PathScratch &scratch = sScratch;
+  if (scratch.g.empty()) {
+    scratch.openGeneration.resize(GRID_X * GRID_Y, 0);
+    scratch.closedGeneration.resize(GRID_X * GRID_Y, 0);
+    scratch.g.resize(GRID_X * GRID_Y);
+    scratch.parent.resize(GRID_X * GRID_Y);
+  }
+
+  // Wrap around, invalidate all stamps
+  if (++scratch.generation == 0) {
+    std::fill(scratch.openGeneration.begin(), scratch.openGeneration.end(), 0);
+    std::fill(scratch.closedGeneration.begin(),
+              scratch.closedGeneration.end(), 0);
+    scratch.generation = 1;
+  }
+  const uint32_t generation = scratch.generation;
+  scratch.cellsVisited = 0;
+
+  // (f, cellIdx)
+  typedef std::pair<int, int> OpenNode;
+  std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>>
+      openList;
+
+  const int startIdx = start.y * GRID_X + start.x;
+  const int goalIdx = goal.y * GRID_X + goal.x;
+
+  scratch.g[startIdx] = 0;
+  scratch.parent[startIdx] = -1;
+  scratch.openGeneration[startIdx] = generation;
+  openList.push({OctileDistance(start.x, start.y, goal.x, goal.y), startIdx});
+
+  constexpr int directions[8][2] = {
+      {1, 0}, {-1, 0}, {0, -1}, {0, 1}, {1, -1}, {-1, -1}, {1, 1}, {-1, 1},
+  };
+
+  bool found = false;
+  uint32_t cellsExpanded = 0;
+  while (!openList.empty()) {
+    const int cellIdx = openList.top().second;
+    openList.pop();
+
+    // Stale entry
+    if (scratch.closedGeneration[cellIdx] == generation) {
+      continue;
+    }
+    scratch.closedGeneration[cellIdx] = generation;
+    cellsExpanded++;
+
+    if (cellIdx == goalIdx) {
+      found = true;
+      break;
+    }
+
+    const int x = cellIdx % GRID_X;
+    const int y = cellIdx / GRID_X;
+
+    // Successor directions. Pruned only inside uniform cost regions.
+    int successors[8][2];
+    int successorCount = 0;
+
+    const int parentIdx = scratch.parent[cellIdx];
+    if (parentIdx == -1 ||
+        !IsUniform(costField, x, y, costField[cellIdx])) {
+      for (const auto &dir : directions) {
+        if (dir[0] != 0 && dir[1] != 0 &&
+            (!IsPassable(costField, x + dir[0], y) ||
+             !IsPassable(costField, x, y + dir[1]))) {
+          continue;
+        }
+
+        successors[successorCount][0] = dir[0];
+        successors[successorCount][1] = dir[1];
+        successorCount++;
+      }
+    } else {
+      const int px = parentIdx % GRID_X;
+      const int py = parentIdx / GRID_X;
+      const int dx = (x > px) - (x < px);
+      const int dy = (y > py) - (y < py);
+
+      auto push = [&](int sdx, int sdy) {
+        successors[successorCount][0] = sdx;
+        successors[successorCount][1] = sdy;
+        successorCount++;
+      };
+
+      if (dx != 0 && dy != 0) {
+        const bool isHorizontalPassable = IsPassable(costField, x + dx, y);
+        const bool isVerticalPassable = IsPassable(costField, x, y + dy);
+
+        if (isVerticalPassable) {
+          push(0, dy);
+        }
+        if (isHorizontalPassable) {
+          push(dx, 0);
+        }
+        if (isHorizontalPassable && isVerticalPassable) {
+          push(dx, dy);
+        }
+      } else if (dx != 0) {
+        const bool isNextPassable = IsPassable(costField, x + dx, y);
+        const bool isTopPassable = IsPassable(costField, x, y - 1);
+        const bool isBottomPassable = IsPassable(costField, x, y + 1);
+
+        if (isNextPassable) {
+          push(dx, 0);
+          if (isTopPassable) {
+            push(dx, -1);
+          }
+          if (isBottomPassable) {
+            push(dx, 1);
+          }
+        }
+        if (isTopPassable) {
+          push(0, -1);
+        }
+        if (isBottomPassable) {
+          push(0, 1);
+        }
+      } else {
+        const bool isNextPassable = IsPassable(costField, x, y + dy);
+        const bool isRightPassable = IsPassable(costField, x + 1, y);
+        const bool isLeftPassable = IsPassable(costField, x - 1, y);
+
+        if (isNextPassable) {
+          push(0, dy);
+          if (isRightPassable) {
+            push(1, dy);
+          }
+          if (isLeftPassable) {
+            push(-1, dy);
+          }
+        }
+        if (isRightPassable) {
+          push(1, 0);
+        }
+        if (isLeftPassable) {
+          push(-1, 0);
+        }
+      }
+    }
+
+    for (int i = 0; i < successorCount; i++) {
+      const int dx = successors[i][0];
+      const int dy = successors[i][1];
+
+      const int jumpIdx = Jump(costField, x + dx, y + dy, dx, dy, goal);
+      if (jumpIdx == -1 || scratch.closedGeneration[jumpIdx] == generation) {
+        continue;
+      }
+
+      const int jx = jumpIdx % GRID_X;
+      const int jy = jumpIdx / GRID_X;
+
+      // Every cell walked by a jump shares the cost of the first step
+      const int stepCost = costField[(y + dy) * GRID_X + (x + dx)];
+      const int newG =
+          scratch.g[cellIdx] + stepCost * OctileDistance(x, y, jx, jy);
+
+      if (scratch.openGeneration[jumpIdx] == generation &&
+          newG >= scratch.g[jumpIdx]) {
+        continue;
+      }
+
+      scratch.openGeneration[jumpIdx] = generation;
+      scratch.g[jumpIdx] = newG;
+      scratch.parent[jumpIdx] = cellIdx;
+      openList.push({newG + OctileDistance(jx, jy, goal.x, goal.y), jumpIdx});
+    }
+  }
+
+  if (stats) {
+    stats->cellsExpanded = cellsExpanded;
+    stats->cellsVisited = scratch.cellsVisited;
+  }
+
+  if (!found) {
+    return 0;
+  }
+
+  // Count jump points back to start
+  uint32_t waypointCount = 0;
+  for (int cellIdx = goalIdx; cellIdx != startIdx;
+       cellIdx = scratch.parent[cellIdx]) {
+    waypointCount++;
+  }
+
+  if (waypointCount > maxWaypoints) {
+    return 0;
+  }
+
+  uint32_t waypointIdx = waypointCount;
+  for (int cellIdx = goalIdx; cellIdx != startIdx;
+       cellIdx = scratch.parent[cellIdx]) {
+    outPath[--waypointIdx] = {cellIdx % GRID_X, cellIdx / GRID_X};
+  }
+
+  return waypointCount;
+}
+
+}; // namespace rts
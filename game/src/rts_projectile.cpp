@@ -0,0 +1,218 @@
+#include "rts/rts_projectile.h"
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace rts {
+
+// Hits are found in the 3x3 buckets around each bucket entered
+static_assert(UNIT_RADIUS + PROJECTILE_MAX_RADIUS <= UNIT_GRID_CELL_SIZE);
+
+static constexpr float sNoHit = std::numeric_limits<float>::infinity();
+
+void ProjectilePoolInit(ProjectilePool *pool) {
+  pool->count = 0;
+  pool->droppedCount = 0;
+}
+
+bool ProjectileSpawn(ProjectilePool *pool, const ProjectileDesc &desc) {
+  if (pool->count >= PROJECTILE_CAPACITY) {
+    pool->droppedCount++;
+    return false;
+  }
+
+  const uint32_t idx = pool->count++;
+  pool->positionsX[idx] = desc.origin.x + GRID_X / 2;
+  pool->positionsY[idx] = desc.origin.z + GRID_Y / 2;
+  pool->velocitiesX[idx] = desc.velocity.x;
+  pool->velocitiesY[idx] = desc.velocity.y;
+  pool->radii[idx] =
+      std::clamp(static_cast<float>(desc.radius), 0.0f, PROJECTILE_MAX_RADIUS);
+  pool->rangesLeft[idx] = desc.range;
+  pool->damages[idx] = desc.damage;
+  pool->owners[idx] = desc.owner;
+  return true;
+}
+
+static void ProjectileRemove(ProjectilePool *pool, uint32_t idx) {
+  const uint32_t lastIdx = --pool->count;
+  pool->positionsX[idx] = pool->positionsX[lastIdx];
+  pool->positionsY[idx] = pool->positionsY[lastIdx];
+  pool->velocitiesX[idx] = pool->velocitiesX[lastIdx];
+  pool->velocitiesY[idx] = pool->velocitiesY[lastIdx];
+  pool->radii[idx] = pool->radii[lastIdx];
+  pool->rangesLeft[idx] = pool->rangesLeft[lastIdx];
+  pool->damages[idx] = pool->damages[lastIdx];
+  pool->owners[idx] = pool->owners[lastIdx];
+}
+
+// @returns the segment parameter in [0, 1] where the segment first touches
+// the circle. 'sNoHit' if it does not.
+static inline float SegmentCircleHit(float x0, float y0, float dx, float dy,
+                                     float cx, float cy, float radius) {
+  const float fx = x0 - cx;
+  const float fy = y0 - cy;
+
+  const float c = fx * fx + fy * fy - radius * radius;
+  if (c <= 0.0f) {
+    return 0.0f;
+  }
+
+  // Half 'b' form of the quadratic. Moving away never hits.
+  const float a = dx * dx + dy * dy;
+  const float b = fx * dx + fy * dy;
+  if (a == 0.0f || b >= 0.0f) {
+    return sNoHit;
+  }
+
+  const float discriminant = b * b - a * c;
+  if (discriminant < 0.0f) {
+    return sNoHit;
+  }
+
+  const float t = (-b - std::sqrt(discriminant)) / a;
+  return t <= 1.0f ? t : sNoHit;
+}
+
+static inline bool IsBlocking(const BlockingBitplane *plane, int x, int y) {
+  const uint32_t word = plane->words[y * BLOCKING_WORDS_PER_ROW + (x >> 5)];
+  return (word >> (x & 31)) & 1u;
+}
+
+void ProjectilePoolStep(ProjectilePool *pool, float deltaTime,
+                        const BlockingBitplane *plane,
+                        const UnitGrid *unitGrid,
+                        std::vector<ProjectileHit> *outHits) {
+  if (pool->droppedCount > 0) {
+    spdlog::warn("Projectile pool full, dropped {} projectiles",
+                 pool->droppedCount);
+    pool->droppedCount = 0;
+  }
+
+  uint32_t idx = 0;
+  while (idx < pool->count) {
+    const float x0 = pool->positionsX[idx];
+    const float y0 = pool->positionsY[idx];
+    float dx = pool->velocitiesX[idx] * deltaTime;
+    float dy = pool->velocitiesY[idx] * deltaTime;
+
+    // Clip the segment to the remaining range
+    const float length = std::sqrt(dx * dx + dy * dy);
+    const bool isExpiring = length >= pool->rangesLeft[idx];
+    if (isExpiring && length > 0.0f) {
+      dx *= pool->rangesLeft[idx] / length;
+      dy *= pool->rangesLeft[idx] / length;
+    }
+
+    int cellX = static_cast<int>(std::floor(x0));
+    int cellY = static_cast<int>(std::floor(y0));
+
+    const int stepX = dx > 0.0f ? 1 : -1;
+    const int stepY = dy > 0.0f ? 1 : -1;
+    const float tDeltaX = dx != 0.0f ? 1.0f / std::abs(dx) : sNoHit;
+    const float tDeltaY = dy != 0.0f ? 1.0f / std::abs(dy) : sNoHit;
+    float tMaxX =
+        dx != 0.0f ? (dx > 0.0f ? cellX + 1 - x0 : x0 - cellX) * tDeltaX
+                   : sNoHit;
+    float tMaxY =
+        dy != 0.0f ? (dy > 0.0f ? cellY + 1 - y0 : y0 - cellY) * tDeltaY
+                   : sNoHit;
+
+    const float radius = UNIT_RADIUS + pool->radii[idx];
+    const unitId owner = pool->owners[idx];
+
+    float tEnter = 0.0f;
+    float tUnit = sNoHit;
+    unitId hitUnit = UNIT_ID_INVALID;
+    float tWall = sNoHit;
+    int lastBucketIdx = -1;
+    bool isOutOfBounds = false;
+
+    // Visit cells in segment order until the closest hit is behind the cell
+    while (true) {
+      if (cellX < 0 || cellX >= GRID_X || cellY < 0 || cellY >= GRID_Y) {
+        isOutOfBounds = true;
+        break;
+      }
+
+      const IVec2 bucket = {cellX / UNIT_GRID_CELL_SIZE,
+                            cellY / UNIT_GRID_CELL_SIZE};
+      const int bucketIdx = bucket.y * UNIT_GRID_X + bucket.x;
+
+      if (bucketIdx != lastBucketIdx) {
+        lastBucketIdx = bucketIdx;
+
+        const int minX = std::max(bucket.x - 1, 0);
+        const int maxX = std::min(bucket.x + 1, UNIT_GRID_X - 1);
+        const int minY = std::max(bucket.y - 1, 0);
+        const int maxY = std::min(bucket.y + 1, UNIT_GRID_Y - 1);
+        for (int by = minY; by <= maxY; by++) {
+          // Buckets of a row are contiguous
+          const int rowIdx = by * UNIT_GRID_X;
+          const uint32_t first = unitGrid->bucketStarts[rowIdx + minX];
+          const uint32_t last = unitGrid->bucketStarts[rowIdx + maxX + 1];
+
+          for (uint32_t i = first; i < last; i++) {
+            if (unitGrid->units[i] == owner) {
+              continue;
+            }
+
+            float t = SegmentCircleHit(x0, y0, dx, dy, unitGrid->positionsX[i],
+                                       unitGrid->positionsY[i], radius);
+            if (t < tUnit) {
+              tUnit = t;
+              hitUnit = unitGrid->units[i];
+            }
+          }
+        }
+      }
+
+      if (tUnit <= tEnter) {
+        break;
+      }
+
+      if (IsBlocking(plane, cellX, cellY)) {
+        tWall = tEnter;
+        break;
+      }
+
+      if (tMaxX < tMaxY) {
+        tEnter = tMaxX;
+        tMaxX += tDeltaX;
+        cellX += stepX;
+      } else {
+        tEnter = tMaxY;
+        tMaxY += tDeltaY;
+        cellY += stepY;
+      }
+
+      if (tEnter > 1.0f) {
+        break;
+      }
+    }
+
+    const float tHit = std::min(tUnit, tWall);
+    if (tHit <= 1.0f) {
+      Position point = {x0 + dx * tHit - GRID_X / 2, 0.0f,
+                        y0 + dy * tHit - GRID_Y / 2};
+      outHits->push_back({owner, tUnit <= tWall ? hitUnit : UNIT_ID_INVALID,
+                          point, pool->damages[idx]});
+      ProjectileRemove(pool, idx);
+      continue;
+    }
+
+    if (isExpiring || isOutOfBounds) {
+      ProjectileRemove(pool, idx);
+      continue;
+    }
+
+    pool->positionsX[idx] = x0 + dx;
+    pool->positionsY[idx] = y0 + dy;
+    pool->rangesLeft[idx] -= length;
+    idx++;
+  }
+}
+
+}; // namespace rts
@@ -0,0 +1,24 @@
+#include "rts/rts_query.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace rts {
+
+static std::mutex sStructureMutex;
+static std::unordered_map<const cbz::ecs::IWorld *, uint64_t>
+    sStructureVersions;
+
+void QueryStructureMarkDirty(const cbz::ecs::IWorld *world) {
+  std::lock_guard<std::mutex> lock(sStructureMutex);
+  sStructureVersions[world]++;
+}
+
+uint64_t QueryStructureVersion(const cbz::ecs::IWorld *world) {
+  std::lock_guard<std::mutex> lock(sStructureMutex);
+
+  auto it = sStructureVersions.find(world);
+  return it != sStructureVersions.end() ? it->second : 0;
+}
+
+}; // namespace rts
@@ -0,0 +1,187 @@
+#include "rts/rts_scheduler.h"
+
+#include "spdlog/spdlog.h"
+
+#include <atomic>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+
+namespace rts {
+
+static std::mutex sAccessTypeMutex;
+static std::unordered_map<std::type_index, uint32_t> sAccessTypes;
+
+uint32_t SystemAccessTypeOf(const std::type_info &type) {
+  std::lock_guard<std::mutex> lock(sAccessTypeMutex);
+
+  auto it = sAccessTypes.find(type);
+  if (it != sAccessTypes.end()) {
+    return it->second;
+  }
+
+  const uint32_t count = static_cast<uint32_t>(sAccessTypes.size());
+  if (count >= SYSTEM_MAX_ACCESS_TYPES) {
+    // Types past the limit alias, which only adds dependencies
+    spdlog::warn("SystemAccessTypeOf: more than {} access types",
+                 SYSTEM_MAX_ACCESS_TYPES);
+  }
+
+  const uint32_t bit = count % SYSTEM_MAX_ACCESS_TYPES;
+  sAccessTypes.emplace(type, bit);
+  return bit;
+}
+
+static bool SystemsConflict(const SystemDesc &a, const SystemDesc &b) {
+  if ((a.flags | b.flags) & SYSTEM_FLAGS_EXCLUSIVE) {
+    return true;
+  }
+
+  return (a.access.writes & (b.access.reads | b.access.writes)) ||
+         (b.access.writes & a.access.reads);
+}
+
+static void SystemGraphBuild(SystemScheduler *scheduler) {
+  const uint32_t systemCount =
+      static_cast<uint32_t>(scheduler->systems.size());
+
+  // Edges to each system from earlier ones in registration order
+  std::vector<std::vector<uint32_t>> edges(systemCount);
+  uint32_t lastMainIdx = UINT32_MAX;
+  for (uint32_t j = 0; j < systemCount; j++) {
+    const SystemDesc &system = scheduler->systems[j];
+    for (uint32_t i = 0; i < j; i++) {
+      if (SystemsConflict(scheduler->systems[i], system) ||
+          (i == lastMainIdx && (system.flags & SYSTEM_FLAGS_MAIN_THREAD))) {
+        edges[i].push_back(j);
+      }
+    }
+
+    if (system.flags & SYSTEM_FLAGS_MAIN_THREAD) {
+      lastMainIdx = j;
+    }
+  }
+
+  scheduler->dependentStarts.assign(systemCount + 1, 0);
+  scheduler->dependents.clear();
+  scheduler->dependencyCounts.assign(systemCount, 0);
+  for (uint32_t i = 0; i < systemCount; i++) {
+    scheduler->dependentStarts[i] =
+        static_cast<uint32_t>(scheduler->dependents.size());
+    for (uint32_t dependent : edges[i]) {
+      scheduler->dependents.push_back(dependent);
+      scheduler->dependencyCounts[dependent]++;
+    }
+  }
+  scheduler->dependentStarts[systemCount] =
+      static_cast<uint32_t>(scheduler->dependents.size());
+
+  scheduler->waitCounts =
+      std::make_unique<std::atomic<uint32_t>[]>(systemCount);
+  scheduler->isGraphDirty = false;
+}
+
+static void SystemSubmit(SystemScheduler *scheduler, uint32_t systemIdx,
+                         JobCounter *counter);
+
+// @brief Prepares the systems from 'firstIdx' on.
+static void SystemsPrepare(SystemScheduler *scheduler, uint32_t firstIdx) {
+  for (uint32_t i = firstIdx; i < scheduler->systems.size(); i++) {
+    const SystemDesc &system = scheduler->systems[i];
+    if (system.prepare) {
+      system.prepare(scheduler->world);
+    }
+  }
+}
+
+static void SystemExecute(SystemScheduler *scheduler, uint32_t systemIdx,
+                          JobCounter *counter) {
+  const SystemDesc &system = scheduler->systems[systemIdx];
+  system.fn(scheduler->world);
+
+  // Still alone, so later systems see structural changes it made
+  if (system.flags & SYSTEM_FLAGS_EXCLUSIVE) {
+    SystemsPrepare(scheduler, systemIdx + 1);
+  }
+
+  // Dependents are submitted before this job finishes so 'counter' only
+  // reaches 0 once every system ran
+  for (uint32_t i = scheduler->dependentStarts[systemIdx];
+       i < scheduler->dependentStarts[systemIdx + 1]; i++) {
+    const uint32_t dependent = scheduler->dependents[i];
+    if (scheduler->waitCounts[dependent].fetch_sub(1) == 1) {
+      SystemSubmit(scheduler, dependent, counter);
+    }
+  }
+}
+
+static void SystemSubmit(SystemScheduler *scheduler, uint32_t systemIdx,
+                         JobCounter *counter) {
+  const uint32_t flags =
+      (scheduler->systems[systemIdx].flags & SYSTEM_FLAGS_MAIN_THREAD)
+          ? JOB_FLAGS_MAIN_THREAD
+          : JOB_FLAGS_NONE;
+
+  JobSystemSubmit(
+      scheduler->jobs,
+      [scheduler, systemIdx, counter]() {
+        SystemExecute(scheduler, systemIdx, counter);
+      },
+      counter, flags);
+}
+
+void SystemSchedulerInit(SystemScheduler *scheduler, JobSystem *jobs) {
+  scheduler->systems.clear();
+  scheduler->isGraphDirty = true;
+  scheduler->changeTick = 1;
+  for (ChangeTicks &changes : scheduler->changes) {
+    changes.entityTicks.clear();
+    changes.blockTicks.clear();
+  }
+  scheduler->jobs = jobs;
+  scheduler->world = nullptr;
+}
+
+void SystemSchedulerShutdown(SystemScheduler *scheduler) {
+  scheduler->systems.clear();
+  scheduler->waitCounts.reset();
+  scheduler->isGraphDirty = true;
+}
+
+void SystemSchedulerAdd(SystemScheduler *scheduler, const SystemDesc &desc) {
+  scheduler->systems.push_back(desc);
+  scheduler->isGraphDirty = true;
+}
+
+void SystemSchedulerRun(SystemScheduler *scheduler,
+                        cbz::ecs::IWorld *world) {
+  const uint32_t systemCount =
+      static_cast<uint32_t>(scheduler->systems.size());
+  if (systemCount == 0) {
+    return;
+  }
+
+  if (scheduler->isGraphDirty) {
+    SystemGraphBuild(scheduler);
+  }
+
+  scheduler->world = world;
+  SystemsPrepare(scheduler, 0);
+  for (uint32_t i = 0; i < systemCount; i++) {
+    scheduler->waitCounts[i] = scheduler->dependencyCounts[i];
+  }
+
+  JobCounter counter;
+  for (uint32_t i = 0; i < systemCount; i++) {
+    if (scheduler->dependencyCounts[i] == 0) {
+      SystemSubmit(scheduler, i, &counter);
+    }
+  }
+
+  JobSystemWait(scheduler->jobs, &counter);
+
+  scheduler->world = nullptr;
+  scheduler->changeTick++;
+}
+
+}; // namespace rts
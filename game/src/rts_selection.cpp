@@ -0,0 +1,177 @@
+#include "rts/rts_selection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace rts {
+
+// Buckets added around the footprint for units near bucket edges
+static constexpr int sSelectionBucketPadding = 1;
+
+// @brief Intersects the ray through 'ndc' with the ground plane.
+// @returns false if the ray misses the ground in front of the camera.
+// 'outPoint' is in fine grid cell space.
+static bool GroundPointFromNdc(const float *m, Vec2 ndc, Vec2 *outPoint) {
+  // Solve clip.x = ndc.x * clip.w and clip.y = ndc.y * clip.w for (x, 0, z)
+  const float a0 = m[0] - ndc.x * m[3];
+  const float b0 = m[8] - ndc.x * m[11];
+  const float c0 = m[12] - ndc.x * m[15];
+  const float a1 = m[1] - ndc.y * m[3];
+  const float b1 = m[9] - ndc.y * m[11];
+  const float c1 = m[13] - ndc.y * m[15];
+
+  const float det = a0 * b1 - a1 * b0;
+  if (std::abs(det) < 1e-8f) {
+    return false;
+  }
+
+  const float x = (b0 * c1 - b1 * c0) / det;
+  const float z = (a1 * c0 - a0 * c1) / det;
+  if (m[3] * x + m[11] * z + m[15] <= 0.0f) {
+    return false;
+  }
+
+  *outPoint = {x + GRID_X / 2, z + GRID_Y / 2};
+  return true;
+}
+
+void SelectUnitsInRect(const UnitGrid *grid, const float *viewProj,
+                       Vec2 ndcMin, Vec2 ndcMax,
+                       std::vector<unitId> *outUnits) {
+  if (grid->units.empty()) {
+    return;
+  }
+
+  const float minX = std::min(ndcMin.x, ndcMax.x);
+  const float maxX = std::max(ndcMin.x, ndcMax.x);
+  const float minY = std::min(ndcMin.y, ndcMax.y);
+  const float maxY = std::max(ndcMin.y, ndcMax.y);
+
+  // Buckets under the rectangle. All of them if a corner misses the ground.
+  IVec2 bucketMin = {0, 0};
+  IVec2 bucketMax = {UNIT_GRID_X - 1, UNIT_GRID_Y - 1};
+
+  const Vec2 corners[4] = {
+      {minX, minY}, {maxX, minY}, {minX, maxY}, {maxX, maxY}};
+  Vec2 footprintMin = {std::numeric_limits<float>::infinity(),
+                       std::numeric_limits<float>::infinity()};
+  Vec2 footprintMax = {-std::numeric_limits<float>::infinity(),
+                       -std::numeric_limits<float>::infinity()};
+  bool isFootprintBounded = true;
+  for (const Vec2 &corner : corners) {
+    Vec2 point;
+    if (!GroundPointFromNdc(viewProj, corner, &point)) {
+      isFootprintBounded = false;
+      break;
+    }
+
+    footprintMin = {std::min(footprintMin.x, point.x),
+                    std::min(footprintMin.y, point.y)};
+    footprintMax = {std::max(footprintMax.x, point.x),
+                    std::max(footprintMax.y, point.y)};
+  }
+
+  if (isFootprintBounded) {
+    const float bucketSize = static_cast<float>(UNIT_GRID_CELL_SIZE);
+    const float lo = -1.0f;
+    const float hi = static_cast<float>(std::max(UNIT_GRID_X, UNIT_GRID_Y));
+    const auto toBucket = [&](float v) {
+      return static_cast<int>(std::floor(std::clamp(v / bucketSize, lo, hi)));
+    };
+
+    bucketMin = {std::max(toBucket(footprintMin.x) - sSelectionBucketPadding,
+                          0),
+                 std::max(toBucket(footprintMin.y) - sSelectionBucketPadding,
+                          0)};
+    bucketMax = {std::min(toBucket(footprintMax.x) + sSelectionBucketPadding,
+                          UNIT_GRID_X - 1),
+                 std::min(toBucket(footprintMax.y) + sSelectionBucketPadding,
+                          UNIT_GRID_Y - 1)};
+  }
+
+  // Fold the grid to world offset into the translation
+  const float *m = viewProj;
+  const float halfX = GRID_X / 2;
+  const float halfY = GRID_Y / 2;
+  const float tx = m[12] - m[0] * halfX - m[8] * halfY;
+  const float ty = m[13] - m[1] * halfX - m[9] * halfY;
+  const float tw = m[15] - m[3] * halfX - m[11] * halfY;
+
+  const float *positionsX = grid->positionsX.data();
+  const float *positionsY = grid->positionsY.data();
+  const unitId *units = grid->units.data();
+
+#if defined(__SSE2__)
+  const __m128 m0 = _mm_set1_ps(m[0]);
+  const __m128 m1 = _mm_set1_ps(m[1]);
+  const __m128 m3 = _mm_set1_ps(m[3]);
+  const __m128 m8 = _mm_set1_ps(m[8]);
+  const __m128 m9 = _mm_set1_ps(m[9]);
+  const __m128 m11 = _mm_set1_ps(m[11]);
+  const __m128 vtx = _mm_set1_ps(tx);
+  const __m128 vty = _mm_set1_ps(ty);
+  const __m128 vtw = _mm_set1_ps(tw);
+  const __m128 vMinX = _mm_set1_ps(minX);
+  const __m128 vMaxX = _mm_set1_ps(maxX);
+  const __m128 vMinY = _mm_set1_ps(minY);
+  const __m128 vMaxY = _mm_set1_ps(maxY);
+#endif
+
+  // Buckets of a row are contiguous
+  for (int y = bucketMin.y; y <= bucketMax.y; y++) {
+    uint32_t i = grid->bucketStarts[y * UNIT_GRID_X + bucketMin.x];
+    const uint32_t end = grid->bucketStarts[y * UNIT_GRID_X + bucketMax.x + 1];
+
+#if defined(__SSE2__)
+    for (; i + 4 <= end; i += 4) {
+      const __m128 px = _mm_loadu_ps(positionsX + i);
+      const __m128 py = _mm_loadu_ps(positionsY + i);
+
+      const __m128 cx =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, px), _mm_mul_ps(m8, py)), vtx);
+      const __m128 cy =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, px), _mm_mul_ps(m9, py)), vty);
+      const __m128 cw =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, px), _mm_mul_ps(m11, py)), vtw);
+
+      // Compare in clip space to avoid the divide
+      __m128 inside = _mm_cmpgt_ps(cw, _mm_setzero_ps());
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(cx, _mm_mul_ps(vMinX, cw)));
+      inside = _mm_and_ps(inside, _mm_cmple_ps(cx, _mm_mul_ps(vMaxX, cw)));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(cy, _mm_mul_ps(vMinY, cw)));
+      inside = _mm_and_ps(inside, _mm_cmple_ps(cy, _mm_mul_ps(vMaxY, cw)));
+
+      const int mask = _mm_movemask_ps(inside);
+      if (mask == 0) {
+        continue;
+      }
+
+      for (uint32_t lane = 0; lane < 4; lane++) {
+        if (mask & (1 << lane)) {
+          outUnits->push_back(units[i + lane]);
+        }
+      }
+    }
+#endif
+
+    for (; i < end; i++) {
+      const float px = positionsX[i];
+      const float py = positionsY[i];
+      const float cx = m[0] * px + m[8] * py + tx;
+      const float cy = m[1] * px + m[9] * py + ty;
+      const float cw = m[3] * px + m[11] * py + tw;
+
+      if (cw > 0.0f && cx >= minX * cw && cx <= maxX * cw &&
+          cy >= minY * cw && cy <= maxY * cw) {
+        outUnits->push_back(units[i]);
+      }
+    }
+  }
+}
+
+}; // namespace rts
@@ -0,0 +1,260 @@
+#include "rts/rts_status.h"
+
+#include <algorithm>
+
+namespace rts {
+
+static constexpr uint32_t sInvalidIdx = UINT32_MAX;
+
+// Durations at 30 steps per second
+static const StatusEffectDesc sStatusEffectDescs[STATUS_EFFECT_TYPE_COUNT] = {
+    {150, 15, 1.0f, 10}, // bleed
+    {90, 30, 2.0f, 5},   // rot
+};
+
+const StatusEffectDesc &StatusEffectDescGet(StatusEffectType type) {
+  return sStatusEffectDescs[type];
+}
+
+static inline uint64_t EffectKey(unitId unit, StatusEffectType type) {
+  return (static_cast<uint64_t>(unit) << 32) | type;
+}
+
+// --- Timing wheel ---
+static void TimerUnlink(StatusEffectPool *pool, uint32_t effectIdx) {
+  const uint32_t slot = pool->timerSlot[effectIdx];
+  if (slot == sInvalidIdx) {
+    return;
+  }
+
+  const uint32_t next = pool->timerNext[effectIdx];
+  const uint32_t prev = pool->timerPrev[effectIdx];
+  if (prev != sInvalidIdx) {
+    pool->timerNext[prev] = next;
+  } else {
+    pool->slotHeads[slot] = next;
+  }
+
+  if (next != sInvalidIdx) {
+    pool->timerPrev[next] = prev;
+  }
+
+  pool->timerSlot[effectIdx] = sInvalidIdx;
+}
+
+static void TimerSchedule(StatusEffectPool *pool, uint32_t effectIdx,
+                          uint64_t deadline) {
+  TimerUnlink(pool, effectIdx);
+
+  deadline = std::max(deadline, pool->tick);
+
+  // Lowest level whose span covers the delay. Clamp past the top level.
+  const uint64_t delay = deadline - pool->tick;
+  uint32_t level = 0;
+  while (level < STATUS_WHEEL_LEVELS - 1 &&
+         delay >= (1ull << (STATUS_WHEEL_SLOT_BITS * (level + 1)))) {
+    level++;
+  }
+
+  const uint64_t maxDelay =
+      (1ull << (STATUS_WHEEL_SLOT_BITS * STATUS_WHEEL_LEVELS)) - 1;
+  if (delay > maxDelay) {
+    deadline = pool->tick + maxDelay;
+  }
+
+  const uint32_t shift = STATUS_WHEEL_SLOT_BITS * level;
+  const uint32_t slot = level * STATUS_WHEEL_SLOTS +
+                        ((deadline >> shift) & (STATUS_WHEEL_SLOTS - 1));
+
+  pool->deadlines[effectIdx] = deadline;
+  pool->timerSlot[effectIdx] = slot;
+  pool->timerPrev[effectIdx] = sInvalidIdx;
+  pool->timerNext[effectIdx] = pool->slotHeads[slot];
+  if (pool->slotHeads[slot] != sInvalidIdx) {
+    pool->timerPrev[pool->slotHeads[slot]] = effectIdx;
+  }
+  pool->slotHeads[slot] = effectIdx;
+}
+
+// @returns head of the detached timer list in 'slot'.
+static uint32_t SlotDetach(StatusEffectPool *pool, uint32_t slot) {
+  const uint32_t head = pool->slotHeads[slot];
+  pool->slotHeads[slot] = sInvalidIdx;
+
+  for (uint32_t idx = head; idx != sInvalidIdx; idx = pool->timerNext[idx]) {
+    pool->timerSlot[idx] = sInvalidIdx;
+  }
+
+  return head;
+}
+
+// @brief Schedules the next event of an effect. Effects that neither expire
+// nor tick stay off the wheel.
+static void EffectSchedule(StatusEffectPool *pool, uint32_t effectIdx) {
+  const StatusEffectDesc &desc = sStatusEffectDescs[pool->types[effectIdx]];
+
+  uint64_t deadline = UINT64_MAX;
+  if (desc.durationTicks > 0) {
+    deadline = pool->expiryTicks[effectIdx];
+  }
+  if (desc.periodTicks > 0) {
+    deadline = std::min(deadline, pool->nextPeriodTicks[effectIdx]);
+  }
+
+  if (deadline == UINT64_MAX) {
+    TimerUnlink(pool, effectIdx);
+    return;
+  }
+
+  TimerSchedule(pool, effectIdx, deadline);
+}
+
+// --- Effects ---
+static void EffectRelease(StatusEffectPool *pool, uint32_t effectIdx) {
+  TimerUnlink(pool, effectIdx);
+  pool->effectLookup.erase(
+      EffectKey(pool->units[effectIdx], pool->types[effectIdx]));
+  pool->stacks[effectIdx] = 0;
+  pool->freeEffects.push_back(effectIdx);
+}
+
+static uint32_t EffectAcquire(StatusEffectPool *pool) {
+  if (!pool->freeEffects.empty()) {
+    uint32_t effectIdx = pool->freeEffects.back();
+    pool->freeEffects.pop_back();
+    return effectIdx;
+  }
+
+  pool->units.push_back(0);
+  pool->types.push_back(STATUS_EFFECT_TYPE_BLEED);
+  pool->stacks.push_back(0);
+  pool->expiryTicks.push_back(0);
+  pool->nextPeriodTicks.push_back(0);
+  pool->deadlines.push_back(0);
+  pool->timerNext.push_back(sInvalidIdx);
+  pool->timerPrev.push_back(sInvalidIdx);
+  pool->timerSlot.push_back(sInvalidIdx);
+
+  return static_cast<uint32_t>(pool->units.size() - 1);
+}
+
+void StatusEffectPoolInit(StatusEffectPool *pool) {
+  pool->units.clear();
+  pool->types.clear();
+  pool->stacks.clear();
+  pool->expiryTicks.clear();
+  pool->nextPeriodTicks.clear();
+  pool->deadlines.clear();
+  pool->timerNext.clear();
+  pool->timerPrev.clear();
+  pool->timerSlot.clear();
+  std::fill(std::begin(pool->slotHeads), std::end(pool->slotHeads),
+            sInvalidIdx);
+  pool->freeEffects.clear();
+  pool->effectLookup.clear();
+  pool->tick = 0;
+}
+
+void StatusEffectApply(StatusEffectPool *pool, unitId unit,
+                       StatusEffectType type, uint32_t stacks) {
+  const StatusEffectDesc &desc = sStatusEffectDescs[type];
+
+  uint32_t effectIdx;
+  auto it = pool->effectLookup.find(EffectKey(unit, type));
+  if (it != pool->effectLookup.end()) {
+    effectIdx = it->second;
+  } else {
+    effectIdx = EffectAcquire(pool);
+    pool->units[effectIdx] = unit;
+    pool->types[effectIdx] = type;
+    pool->stacks[effectIdx] = 0;
+    pool->nextPeriodTicks[effectIdx] = pool->tick + desc.periodTicks;
+    pool->effectLookup[EffectKey(unit, type)] = effectIdx;
+  }
+
+  // Reapplying keeps the damage tick phase and refreshes the expiry
+  pool->stacks[effectIdx] =
+      std::min(pool->stacks[effectIdx] + stacks, desc.maxStacks);
+  pool->expiryTicks[effectIdx] = pool->tick + desc.durationTicks;
+
+  EffectSchedule(pool, effectIdx);
+}
+
+void StatusEffectRemove(StatusEffectPool *pool, unitId unit,
+                        StatusEffectType type) {
+  auto it = pool->effectLookup.find(EffectKey(unit, type));
+  if (it == pool->effectLookup.end()) {
+    return;
+  }
+
+  EffectRelease(pool, it->second);
+}
+
+void StatusEffectRemoveAll(StatusEffectPool *pool, unitId unit) {
+  for (uint32_t type = 0; type < STATUS_EFFECT_TYPE_COUNT; type++) {
+    StatusEffectRemove(pool, unit, static_cast<StatusEffectType>(type));
+  }
+}
+
+uint32_t StatusEffectGetStacks(const StatusEffectPool *pool, unitId unit,
+                               StatusEffectType type) {
+  auto it = pool->effectLookup.find(EffectKey(unit, type));
+  if (it == pool->effectLookup.end()) {
+    return 0;
+  }
+
+  return pool->stacks[it->second];
+}
+
+void StatusEffectPoolStep(StatusEffectPool *pool,
+                          std::vector<StatusEffectEvent> *outEvents) {
+  const uint64_t tick = pool->tick;
+
+  // Cascade timers down from each level whose slot came due. Every timer
+  // cascades at most once per level over its lifetime.
+  for (uint32_t level = 1; level < STATUS_WHEEL_LEVELS; level++) {
+    const uint32_t shift = STATUS_WHEEL_SLOT_BITS * level;
+    if ((tick & ((1ull << shift) - 1)) != 0) {
+      break;
+    }
+
+    const uint32_t slot = level * STATUS_WHEEL_SLOTS +
+                          ((tick >> shift) & (STATUS_WHEEL_SLOTS - 1));
+    uint32_t effectIdx = SlotDetach(pool, slot);
+    while (effectIdx != sInvalidIdx) {
+      const uint32_t next = pool->timerNext[effectIdx];
+      TimerSchedule(pool, effectIdx, pool->deadlines[effectIdx]);
+      effectIdx = next;
+    }
+  }
+
+  // Fire timers due this tick
+  uint32_t effectIdx =
+      SlotDetach(pool, static_cast<uint32_t>(tick & (STATUS_WHEEL_SLOTS - 1)));
+  while (effectIdx != sInvalidIdx) {
+    const uint32_t next = pool->timerNext[effectIdx];
+    const StatusEffectDesc &desc = sStatusEffectDescs[pool->types[effectIdx]];
+
+    if (desc.periodTicks > 0 && pool->nextPeriodTicks[effectIdx] <= tick) {
+      outEvents->push_back({pool->units[effectIdx], pool->types[effectIdx],
+                            pool->stacks[effectIdx],
+                            desc.damagePerStack * pool->stacks[effectIdx],
+                            false});
+      pool->nextPeriodTicks[effectIdx] = tick + desc.periodTicks;
+    }
+
+    if (desc.durationTicks > 0 && pool->expiryTicks[effectIdx] <= tick) {
+      outEvents->push_back({pool->units[effectIdx], pool->types[effectIdx],
+                            pool->stacks[effectIdx], 0.0f, true});
+      EffectRelease(pool, effectIdx);
+    } else {
+      EffectSchedule(pool, effectIdx);
+    }
+
+    effectIdx = next;
+  }
+
+  pool->tick++;
+}
+
+}; // namespace rts
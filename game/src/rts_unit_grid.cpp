@@ -0,0 +1,55 @@
+#include "rts/rts_unit_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rts {
+
+static_assert(GRID_X % UNIT_GRID_CELL_SIZE == 0 &&
+              GRID_Y % UNIT_GRID_CELL_SIZE == 0);
+
+IVec2 UnitGridBucket(Vec2 position) {
+  constexpr float invCellSize = 1.0f / UNIT_GRID_CELL_SIZE;
+
+  int x = static_cast<int>(std::floor(position.x * invCellSize));
+  int y = static_cast<int>(std::floor(position.y * invCellSize));
+  return {std::clamp(x, 0, UNIT_GRID_X - 1),
+          std::clamp(y, 0, UNIT_GRID_Y - 1)};
+}
+
+void UnitGridBuild(UnitGrid *grid, const unitId *units, const Vec2 *positions,
+                   const uint32_t *teams, uint32_t count) {
+  grid->bucketStarts.assign(UNIT_GRID_X * UNIT_GRID_Y + 1, 0);
+  grid->units.resize(count);
+  grid->positionsX.resize(count);
+  grid->positionsY.resize(count);
+  grid->teams.resize(count);
+
+  std::vector<uint32_t> bucketIdxs(count);
+  for (uint32_t i = 0; i < count; i++) {
+    IVec2 bucket = UnitGridBucket(positions[i]);
+    bucketIdxs[i] = bucket.y * UNIT_GRID_X + bucket.x;
+    grid->bucketStarts[bucketIdxs[i] + 1]++;
+  }
+
+  for (uint32_t i = 0; i < UNIT_GRID_X * UNIT_GRID_Y; i++) {
+    grid->bucketStarts[i + 1] += grid->bucketStarts[i];
+  }
+
+  // Scatter using the bucket starts as write cursors. Each cursor ends at the
+  // start of the next bucket so shift them back afterwards.
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t dstIdx = grid->bucketStarts[bucketIdxs[i]]++;
+    grid->units[dstIdx] = units[i];
+    grid->positionsX[dstIdx] = positions[i].x;
+    grid->positionsY[dstIdx] = positions[i].y;
+    grid->teams[dstIdx] = teams[i];
+  }
+
+  for (uint32_t i = UNIT_GRID_X * UNIT_GRID_Y; i > 0; i--) {
+    grid->bucketStarts[i] = grid->bucketStarts[i - 1];
+  }
+  grid->bucketStarts[0] = 0;
+}
+
+}; // namespace rts
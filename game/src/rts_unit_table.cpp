@@ -0,0 +1,143 @@
+#include "rts/rts_unit_table.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace rts {
+
+static constexpr uint32_t sUnitTableMagic = 0x55535452; // "RTSU"
+static constexpr uint64_t sFnvPrime = 0x100000001b3ull;
+
+struct UnitTableHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t sourceHash;
+  uint32_t realSize;
+  uint32_t archetypeCount;
+  uint32_t namesSize;
+  uint32_t reserved;
+};
+
+void UnitTableInit(UnitTable *table, uint64_t sourceHash) {
+  table->sourceHash = sourceHash;
+  table->archetypes.clear();
+  table->names.clear();
+}
+
+UnitAssetId UnitTableAdd(UnitTable *table, const Unit &unit) {
+  const char *name = unit.name ? unit.name : "";
+
+  UnitArchetype archetype;
+  archetype.health = unit.health;
+  archetype.mana = unit.mana;
+  archetype.damage = unit.damage;
+  archetype.armor = unit.armor;
+  archetype.movement_speed = unit.movement_speed;
+  archetype.nameOffset = static_cast<uint32_t>(table->names.size());
+
+  table->names.insert(table->names.end(), name, name + strlen(name) + 1);
+  table->archetypes.push_back(archetype);
+
+  return {static_cast<uint32_t>(table->archetypes.size() - 1)};
+}
+
+UnitAssetId UnitTableFind(const UnitTable *table, const char *name) {
+  for (uint32_t i = 0; i < table->archetypes.size(); i++) {
+    if (strcmp(&table->names[table->archetypes[i].nameOffset], name) == 0) {
+      return {i};
+    }
+  }
+
+  return {UNIT_ASSET_ID_INVALID};
+}
+
+Unit UnitTableGet(const UnitTable *table, UnitAssetId id) {
+  const UnitArchetype &archetype = table->archetypes[id.idx];
+
+  Unit unit;
+  unit.name = &table->names[archetype.nameOffset];
+  unit.health = archetype.health;
+  unit.mana = archetype.mana;
+  unit.damage = archetype.damage;
+  unit.armor = archetype.armor;
+  unit.movement_speed = archetype.movement_speed;
+  return unit;
+}
+
+uint64_t UnitTableHash(const void *data, size_t size, uint64_t hash) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * sFnvPrime;
+  }
+
+  return hash;
+}
+
+cbz::Result UnitTableWrite(const UnitTable *table, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return cbz::Result::eFileError;
+  }
+
+  UnitTableHeader header = {};
+  header.magic = sUnitTableMagic;
+  header.version = UNIT_TABLE_VERSION;
+  header.sourceHash = table->sourceHash;
+  header.realSize = sizeof(real_t);
+  header.archetypeCount = static_cast<uint32_t>(table->archetypes.size());
+  header.namesSize = static_cast<uint32_t>(table->names.size());
+
+  bool isWritten =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(table->archetypes.data(), sizeof(UnitArchetype),
+             table->archetypes.size(),
+             file) == table->archetypes.size() &&
+      fwrite(table->names.data(), 1, table->names.size(), file) ==
+          table->names.size();
+
+  fclose(file);
+  return isWritten ? cbz::Result::eSuccess : cbz::Result::eFileError;
+}
+
+cbz::Result UnitTableRead(UnitTable *table, const char *path,
+                          uint64_t sourceHash) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return cbz::Result::eFileError;
+  }
+
+  UnitTableHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      header.magic != sUnitTableMagic ||
+      header.version != UNIT_TABLE_VERSION ||
+      header.sourceHash != sourceHash || header.realSize != sizeof(real_t)) {
+    fclose(file);
+    return cbz::Result::eFailure;
+  }
+
+  UnitTableInit(table, sourceHash);
+  table->archetypes.resize(header.archetypeCount);
+  table->names.resize(header.namesSize);
+
+  bool isRead =
+      fread(table->archetypes.data(), sizeof(UnitArchetype),
+            table->archetypes.size(), file) == table->archetypes.size() &&
+      fread(table->names.data(), 1, table->names.size(), file) ==
+          table->names.size();
+  fclose(file);
+
+  // Names must stay in bounds and terminated
+  for (const UnitArchetype &archetype : table->archetypes) {
+    isRead &= archetype.nameOffset < table->names.size();
+  }
+  isRead &= table->names.empty() || table->names.back() == '\0';
+
+  if (!isRead) {
+    UnitTableInit(table, 0);
+    return cbz::Result::eFailure;
+  }
+
+  return cbz::Result::eSuccess;
+}
+
+}; // namespace rts